@@ -4,10 +4,42 @@
 #include <cstdlib>
 #include <vector>
 #include <stdexcept>
+#include <utility>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BINT_AVX2
+#include <immintrin.h>
+#endif
 
 namespace Util {
 
-const size_t MIN_CAPACITY = 2048;
+const size_t INLINE_CAPACITY = 4;
+// Multiplication cutovers, measured on random operands. Below
+// SCHOOLBOOK_THRESHOLD 32-bit limbs in the shorter operand a product runs
+// limb by limb in place. The next three count digits of the _Multiply
+// kernels in the shorter operand: 16-bit halves in products, two per limb,
+// and base-10000 digits in decimal conversion. Each can be overridden with
+// -DBINT_<NAME>=n, which tests/bint_multiply_bench.cpp uses to find them.
+#ifndef BINT_SCHOOLBOOK_THRESHOLD
+#define BINT_SCHOOLBOOK_THRESHOLD 768
+#endif
+#ifndef BINT_KARATSUBA_THRESHOLD
+#define BINT_KARATSUBA_THRESHOLD 128
+#endif
+#ifndef BINT_TOOM3_THRESHOLD
+#define BINT_TOOM3_THRESHOLD 256
+#endif
+#ifndef BINT_NTT_THRESHOLD
+#define BINT_NTT_THRESHOLD 12288
+#endif
+const size_t SCHOOLBOOK_THRESHOLD = BINT_SCHOOLBOOK_THRESHOLD;
+const size_t KARATSUBA_THRESHOLD = BINT_KARATSUBA_THRESHOLD;
+const size_t TOOM3_THRESHOLD = BINT_TOOM3_THRESHOLD;
+const size_t NTT_THRESHOLD = BINT_NTT_THRESHOLD;
+const size_t NTT_MAX_LENGTH = 1 << 23;
+const size_t CONVERSION_THRESHOLD = 64;
+const size_t NEWTON_THRESHOLD = 8000;
+const size_t MONTGOMERY_THRESHOLD = 2048;
+const size_t SIMD_THRESHOLD = 32;
 
 class Bint {
 	class NewSpaceFailed : public std::runtime_error {
@@ -18,13 +50,82 @@ class Bint {
 	public:
 		BadCast();
 	};
+	class DivideByZero : public std::domain_error {
+	public:
+		DivideByZero();
+	};
+	class NegativeExponent : public std::domain_error {
+	public:
+		NegativeExponent();
+	};
+	// Magnitude in 32-bit binary limbs, least significant first. Values of up
+	// to INLINE_CAPACITY limbs are kept in local and need no allocation.
 	bool isMinus = false;
 	size_t length;
-	int *data = nullptr;
-	size_t capacity = MIN_CAPACITY;
-	void _DoubleSpace();
-	void _SafeNewSpace(int *&p, const size_t &len);
+	unsigned int *data = local;
+	size_t capacity = INLINE_CAPACITY;
+	unsigned int local[INLINE_CAPACITY];
+	void _Reserve(size_t n, bool keep);
+	void _Release();
 	explicit Bint(const size_t &capa);
+	void _Assign(unsigned long long x, bool minus);
+	void _Shrink();
+	static int _CompareAbs(const Bint &lhs, const Bint &rhs);
+
+	// Limb-wise add, subtract and compare on n limbs; out may alias either
+	// input. Long runs go to AVX2 kernels when the CPU has them.
+	static bool _HasAvx2();
+	static unsigned int _AddLimbs(const unsigned int *a, const unsigned int *b, size_t n, unsigned int carry, unsigned int *out);
+	static unsigned int _SubLimbs(const unsigned int *a, const unsigned int *b, size_t n, unsigned int borrow, unsigned int *out);
+	static unsigned int _AddCarry(const unsigned int *a, size_t n, unsigned int carry, unsigned int *out);
+	static unsigned int _SubBorrow(const unsigned int *a, size_t n, unsigned int borrow, unsigned int *out);
+	static int _CompareLimbs(const unsigned int *a, const unsigned int *b, size_t n);
+#ifdef BINT_AVX2
+	static unsigned int _AddLimbsAvx2(const unsigned int *a, const unsigned int *b, size_t n, unsigned int carry, unsigned int *out);
+	static unsigned int _SubLimbsAvx2(const unsigned int *a, const unsigned int *b, size_t n, unsigned int borrow, unsigned int *out);
+	static size_t _MismatchAvx2(const unsigned int *a, const unsigned int *b, size_t n);
+#endif
+	static Bint _AddSigned(const Bint &lhs, const Bint &rhs, bool rhsMinus);
+	void _AddInPlace(const Bint &rhs, bool rhsMinus);
+	static void _MultiplyInto(const Bint &lhs, const Bint &rhs, Bint &out);
+
+	// Kernels on base-Base digits held in long long, so a digit may
+	// temporarily be out of range or negative and carries are propagated once
+	// per product instead of once per digit multiply. Products run on 16-bit
+	// halves of the limbs (Base 65536) and decimal conversion on Base 10000.
+	template<long long Base>
+	static void _Normalize(long long *x, size_t n);
+	template<long long Base>
+	static void _ExactDivide(long long *x, size_t n, long long d);
+	template<long long Base>
+	static void _AddShifted(long long *out, size_t n, const long long *x, size_t m, size_t shift, long long sign);
+	static void _MulSchoolbook(const long long *a, size_t na, const long long *b, size_t nb, long long *out);
+	template<long long Base>
+	static void _MulKaratsuba(const long long *a, size_t na, const long long *b, size_t nb, long long *out);
+	template<long long Base>
+	static void _MulToom3(const long long *a, size_t na, const long long *b, size_t nb, long long *out);
+	static unsigned int _PowMod(unsigned long long base, unsigned long long exp, unsigned int mod);
+	static void _Ntt(unsigned int *x, size_t n, unsigned int mod, bool inverse);
+	static void _MulNtt(const long long *a, size_t na, const long long *b, size_t nb, long long *out);
+	template<long long Base>
+	static void _Multiply(const long long *a, size_t na, const long long *b, size_t nb, long long *out);
+	static size_t _Significant(const long long *x, size_t n);
+	static void _ToHalves(const unsigned int *x, size_t n, long long *out);
+	static void _FromHalves(const long long *x, size_t n, unsigned int *out);
+	static void _ToDecimal(const long long *x, size_t n, long long *out, size_t m, std::vector<std::vector<long long> > &powers);
+	static void _FromDecimal(const long long *x, size_t n, long long *out, size_t m, std::vector<std::vector<long long> > &powers);
+
+	// Division and modular arithmetic on magnitudes; signs are applied by the
+	// public operators.
+	static Bint _FromLimbs(const unsigned int *x, size_t n);
+	static Bint _ShiftLeft(const Bint &x, size_t bits);
+	static Bint _ShiftRight(const Bint &x, size_t bits);
+	static void _DivModKnuth(const Bint &u, const Bint &v, Bint &quotient, Bint &remainder);
+	static Bint _Reciprocal(const Bint &v);
+	static void _DivModNewton(const Bint &u, const Bint &v, Bint &quotient, Bint &remainder);
+	static void _DivModAbs(const Bint &u, const Bint &v, Bint &quotient, Bint &remainder);
+	static void _MontgomeryMultiply(const unsigned int *a, const unsigned int *b, const unsigned int *m, size_t n, unsigned int mInv, unsigned int *t, unsigned int *out);
+	static Bint _BarrettReduce(const Bint &x, const Bint &m, const Bint &mu);
 public:
 	Bint();
 	Bint(int x);
@@ -38,6 +139,10 @@ public:
 	Bint &operator=(const Bint &rhs);
 	Bint &operator=(Bint &&rhs) noexcept;
 
+	Bint &operator+=(const Bint &rhs);
+	Bint &operator-=(const Bint &rhs);
+	Bint &operator*=(const Bint &rhs);
+
 	friend Bint abs(const Bint &x);
 	friend Bint abs(Bint &&x);
 
@@ -49,10 +154,20 @@ public:
 	friend bool operator>=(const Bint &lhs, const Bint &rhs);
 
 	friend Bint operator+(const Bint &lhs, const Bint &rhs);
+	friend Bint operator+(Bint &&lhs, const Bint &rhs);
+	friend Bint operator+(const Bint &lhs, Bint &&rhs);
+	friend Bint operator+(Bint &&lhs, Bint &&rhs);
 	friend Bint operator-(const Bint &b);
 	friend Bint operator-(Bint &&b);
 	friend Bint operator-(const Bint &lhs, const Bint &rhs);
+	friend Bint operator-(Bint &&lhs, const Bint &rhs);
 	friend Bint operator*(const Bint &lhs, const Bint &rhs);
+	friend Bint operator*(Bint &&lhs, const Bint &rhs);
+	friend Bint operator/(const Bint &lhs, const Bint &rhs);
+	friend Bint operator%(const Bint &lhs, const Bint &rhs);
+	friend std::pair<Bint, Bint> divmod(const Bint &lhs, const Bint &rhs);
+	friend Bint pow(const Bint &base, unsigned long long exp);
+	friend Bint powmod(const Bint &base, const Bint &exp, const Bint &mod);
 
 	friend std::istream &operator>>(std::istream &is, Bint &b);
 	friend std::ostream &operator<<(std::ostream &os, const Bint &b);
@@ -68,161 +183,168 @@ namespace Util {
 
 Bint::NewSpaceFailed::NewSpaceFailed() : std::runtime_error("No Enough Memory Space.") {}
 Bint::BadCast::BadCast() : std::invalid_argument("Cannot convert to a Bint object") {}
+Bint::DivideByZero::DivideByZero() : std::domain_error("Division by zero.") {}
+Bint::NegativeExponent::NegativeExponent() : std::domain_error("Negative exponent.") {}
 
-void Bint::_SafeNewSpace(int *&p, const size_t &len)
+/*
+ * Make room for n limbs, keeping the current ones if keep is set. A buffer
+ * that has to grow grows by at least half so repeated += stays linear; fresh
+ * values get exactly what they ask for. New limbs are not cleared.
+ */
+void Bint::_Reserve(size_t n, bool keep)
 {
-	if (p != nullptr) {
-		delete[] p;
-		p = nullptr;
+	if (n <= capacity) {
+		return;
 	}
-	p = new int[len];
+	size_t newCapacity = std::max(n, capacity + (capacity >> 1));
+	unsigned int *p = new unsigned int[newCapacity];
 	if (p == nullptr) {
 		throw NewSpaceFailed();
 	}
-	memset(p, 0, len * sizeof(unsigned int));
+	if (keep) {
+		memcpy(p, data, sizeof(unsigned int) * length);
+	}
+	_Release();
+	data = p;
+	capacity = newCapacity;
 }
 
-void Bint::_DoubleSpace()
+void Bint::_Release()
 {
-	int *newMem = nullptr;
-	_SafeNewSpace(newMem, capacity << 1);
-	memcpy(newMem, data, capacity * sizeof(int));
-	delete[] data;
-	data = newMem;
-	capacity <<= 1;
+	if (data != local) {
+		delete[] data;
+	}
+	data = local;
+	capacity = INLINE_CAPACITY;
+}
+
+void Bint::_Assign(unsigned long long x, bool minus)
+{
+	data[0] = static_cast<unsigned int>(x);
+	data[1] = static_cast<unsigned int>(x >> 32);
+	length = 2;
+	isMinus = minus;
+	_Shrink();
+}
+
+/*
+ * Drop leading zero limbs; zero is never negative.
+ */
+void Bint::_Shrink()
+{
+	while (length > 1 && data[length - 1] == 0) {
+		--length;
+	}
+	if (length == 1 && data[0] == 0) {
+		isMinus = false;
+	}
 }
 
 Bint::Bint()
 	: length(1)
 {
-	_SafeNewSpace(data, capacity);
+	data[0] = 0;
 }
 
 Bint::Bint(int x)
-	: length(0)
+	: length(1)
 {
-	_SafeNewSpace(data, capacity);
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
-	}
-	while (x) {
-		data[length++] = x % 10000;
-		x /= 10000;
-	}
-	if (!length) {
-		length = 1;
-	}
+	_Assign(x < 0 ? 0ULL - static_cast<unsigned long long>(x) : x, x < 0);
 }
 
 Bint::Bint(long long x)
-	: length(0)
+	: length(1)
 {
-	_SafeNewSpace(data, capacity);
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
-	}
-	while (x) {
-		data[length++] = static_cast<unsigned int>(x % 10000);
-		x /= 10000;
-	}
-	if (!length) {
-		length = 1;
-	}
+	_Assign(x < 0 ? 0ULL - static_cast<unsigned long long>(x) : x, x < 0);
 }
 
+/*
+ * Zero with room for capa limbs, all of them cleared.
+ */
 Bint::Bint(const size_t &capa)
 	: length(1)
 {
-	while (capacity < capa) {
-		capacity <<= 1;
-	}
-	_SafeNewSpace(data, capacity);
+	_Reserve(capa, false);
+	memset(data, 0, sizeof(unsigned int) * capacity);
 }
 
+/*
+ * Digits are read four at a time into base 10000 and converted to binary by
+ * divide and conquer, so long inputs cost a few multiplications instead of
+ * one pass per digit.
+ */
 Bint::Bint(std::string x)
+	: length(1)
 {
-	while (x[0] == '-') {
+	size_t start = 0;
+	while (start < x.length() && x[start] == '-') {
 		isMinus = !isMinus;
-		x.erase(0, 1);
+		++start;
 	}
-	while ((capacity << 2) <= x.length()) {
-		capacity <<= 1;
+	if (start == x.length()) {
+		throw BadCast();
 	}
-
-	_SafeNewSpace(data, capacity);
-
-	size_t mid = x.length() >> 1;
-	for (size_t i = 0; i < mid; ++i) {
-		std::swap(x[i], x[x.length() - 1 - i]);
+	for (size_t i = start; i < x.length(); ++i) {
+		if (x[i] > '9' || x[i] < '0') {
+			throw BadCast();
+		}
+	}
+	while (start + 1 < x.length() && x[start] == '0') {
+		++start;
 	}
 
-	const static unsigned int pow10[4] = {1, 10, 100, 1000};
-	for (size_t i = 0; i < capacity; ++i) {
-		if ((i << 2) >= x.length()) {
-			length = i;
-			break;
-		}
-		for (size_t j = 0; j < 4; ++j) {
-			if ((i << 2) + j >= x.length()) {
-				break;
-			}
-			if (x[(i << 2) + j] > '9' || x[(i << 2) + j] < '0') {
-				throw BadCast();
-			}
-			data[i] = data[i] + (x[(i << 2) + j] - '0') * pow10[j];
-		}
+	const static long long pow10[4] = {1, 10, 100, 1000};
+	size_t digits = x.length() - start, n = (digits + 3) >> 2;
+	std::vector<long long> decimal(n, 0);
+	for (size_t i = 0; i < digits; ++i) {
+		decimal[i >> 2] += (x[x.length() - 1 - i] - '0') * pow10[i & 3];
 	}
+	size_t m = n - (n >> 3) + 1;
+	std::vector<long long> halves(m + 1, 0);
+	std::vector<std::vector<long long> > powers;
+	_FromDecimal(&decimal[0], n, &halves[0], m, powers);
+
+	length = (m + 1) >> 1;
+	_Reserve(length, false);
+	_FromHalves(&halves[0], m, data);
+	_Shrink();
 }
 
 Bint::Bint(const Bint &b)
-	: isMinus(b.isMinus), length(b.length), capacity(b.capacity)
+	: isMinus(b.isMinus), length(b.length)
 {
-	_SafeNewSpace(data, capacity);
-	memcpy(data, b.data, sizeof(unsigned int) * capacity);
+	_Reserve(length, false);
+	memcpy(data, b.data, sizeof(unsigned int) * length);
 }
 
+/*
+ * Heap buffers are stolen, inline limbs copied; b is left as zero.
+ */
 Bint::Bint(Bint &&b) noexcept
-	: isMinus(b.isMinus), length(b.length), capacity(b.capacity)
+	: isMinus(b.isMinus), length(b.length)
 {
-	data = b.data;
-	b.data = nullptr;
+	if (b.data != b.local) {
+		data = b.data;
+		capacity = b.capacity;
+		b.data = b.local;
+		b.capacity = INLINE_CAPACITY;
+	} else {
+		memcpy(local, b.local, sizeof(local));
+	}
+	b.length = 1;
+	b.data[0] = 0;
+	b.isMinus = false;
 }
 
 Bint &Bint::operator=(int x)
 {
-	memset(data, 0, sizeof(unsigned int) * capacity);
-	length = 0;
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
-	}
-	while (x) {
-		data[length++] = x % 10000;
-		x /= 10000;
-	}
-	if (!length) {
-		length = 1;
-	}
+	_Assign(x < 0 ? 0ULL - static_cast<unsigned long long>(x) : x, x < 0);
 	return *this;
 }
 
 Bint &Bint::operator=(long long x)
 {
-	memset(data, 0, sizeof(unsigned int) * capacity);
-	length = 0;
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
-	}
-	while (x) {
-		data[length++] = static_cast<unsigned int>(x % 10000);
-		x /= 10000;
-	}
-	if (!length) {
-		length = 1;
-	}
+	_Assign(x < 0 ? 0ULL - static_cast<unsigned long long>(x) : x, x < 0);
 	return *this;
 }
 
@@ -231,11 +353,8 @@ Bint &Bint::operator=(const Bint &rhs)
 	if (this == &rhs) {
 		return *this;
 	}
-	if (rhs.capacity > capacity) {
-		capacity = rhs.capacity;
-		_SafeNewSpace(data, capacity);
-	}
-	memcpy(data, rhs.data, sizeof(unsigned int) * rhs.capacity);
+	_Reserve(rhs.length, false);
+	memcpy(data, rhs.data, sizeof(unsigned int) * rhs.length);
 	length = rhs.length;
 	isMinus = rhs.isMinus;
 	return *this;
@@ -246,11 +365,20 @@ Bint &Bint::operator=(Bint &&rhs) noexcept
 	if (this == &rhs) {
 		return *this;
 	}
-	capacity = rhs.capacity;
+	if (rhs.data != rhs.local) {
+		_Release();
+		data = rhs.data;
+		capacity = rhs.capacity;
+		rhs.data = rhs.local;
+		rhs.capacity = INLINE_CAPACITY;
+	} else {
+		memcpy(data, rhs.data, sizeof(unsigned int) * rhs.length);
+	}
 	length = rhs.length;
 	isMinus = rhs.isMinus;
-	data = rhs.data;
-	rhs.data = nullptr;
+	rhs.length = 1;
+	rhs.data[0] = 0;
+	rhs.isMinus = false;
 	return *this;
 }
 
@@ -264,17 +392,27 @@ std::istream &operator>>(std::istream &is, Bint &b)
 
 std::ostream &operator<<(std::ostream &os, const Bint &b)
 {
-	if (b.data == nullptr) {
-		return os;
-	}
+	size_t n = b.length << 1, m = n + (n >> 2) + 1;
+	std::vector<long long> halves(n), decimal(m);
+	std::vector<std::vector<long long> > powers;
+	Bint::_ToHalves(b.data, b.length, &halves[0]);
+	Bint::_ToDecimal(&halves[0], Bint::_Significant(&halves[0], n), &decimal[0], m, powers);
+	m = Bint::_Significant(&decimal[0], m);
+
+	std::string text;
 	if (b.isMinus && (b.length > 1 || b.data[0] != 0)) {
-		os << "-";
+		text += '-';
 	}
-	os << b.data[b.length - 1];
-	for (long long i = b.length - 2LL; i >= 0; --i) {
-		os << std::setw(4) << std::setfill('0') << b.data[i];
+	text += std::to_string(decimal[m - 1]);
+	size_t pos = text.length();
+	text.resize(pos + ((m - 1) << 2));
+	for (size_t i = m - 1; i-- > 0; pos += 4) {
+		long long digit = decimal[i];
+		for (size_t j = 4; j-- > 0; digit /= 10) {
+			text[pos + j] = static_cast<char>('0' + digit % 10);
+		}
 	}
-	return os;
+	return os << text;
 }
 
 Bint abs(const Bint &b)
@@ -287,230 +425,1227 @@ Bint abs(const Bint &b)
 Bint abs(Bint &&b)
 {
 	b.isMinus = false;
-	return b;
+	return std::move(b);
 }
 
 bool operator==(const Bint &lhs, const Bint &rhs)
+{
+	return lhs.isMinus == rhs.isMinus && lhs.length == rhs.length && Bint::_CompareLimbs(lhs.data, rhs.data, lhs.length) == 0;
+}
+
+bool operator!=(const Bint &lhs, const Bint &rhs)
+{
+	return !(lhs == rhs);
+}
+
+bool operator<(const Bint &lhs, const Bint &rhs)
 {
 	if (lhs.isMinus != rhs.isMinus) {
-		return false;
+		return lhs.isMinus;
 	}
+	int order = Bint::_CompareAbs(lhs, rhs);
+	return lhs.isMinus ? order > 0 : order < 0;
+}
+
+bool operator>(const Bint &lhs, const Bint &rhs)
+{
+	return rhs < lhs;
+}
+
+bool operator<=(const Bint &lhs, const Bint &rhs)
+{
+	return !(rhs < lhs);
+}
+
+bool operator>=(const Bint &lhs, const Bint &rhs)
+{
+	return !(lhs < rhs);
+}
+
+int Bint::_CompareAbs(const Bint &lhs, const Bint &rhs)
+{
 	if (lhs.length != rhs.length) {
-		return false;
+		return lhs.length < rhs.length ? -1 : 1;
+	}
+	return _CompareLimbs(lhs.data, rhs.data, lhs.length);
+}
+
+bool Bint::_HasAvx2()
+{
+#ifdef BINT_AVX2
+	static const bool supported = __builtin_cpu_supports("avx2");
+	return supported;
+#else
+	return false;
+#endif
+}
+
+/*
+ * out = a + b + carry over n limbs; returns the carry out.
+ */
+unsigned int Bint::_AddLimbs(const unsigned int *a, const unsigned int *b, size_t n, unsigned int carry, unsigned int *out)
+{
+	size_t i = 0;
+#ifdef BINT_AVX2
+	if (n >= SIMD_THRESHOLD && _HasAvx2()) {
+		i = n & ~static_cast<size_t>(7);
+		carry = _AddLimbsAvx2(a, b, i, carry, out);
+	}
+#endif
+	for (; i < n; ++i) {
+		unsigned long long sum = static_cast<unsigned long long>(a[i]) + b[i] + carry;
+		out[i] = static_cast<unsigned int>(sum);
+		carry = static_cast<unsigned int>(sum >> 32);
+	}
+	return carry;
+}
+
+/*
+ * out = a - b - borrow over n limbs; returns the borrow out.
+ */
+unsigned int Bint::_SubLimbs(const unsigned int *a, const unsigned int *b, size_t n, unsigned int borrow, unsigned int *out)
+{
+	size_t i = 0;
+#ifdef BINT_AVX2
+	if (n >= SIMD_THRESHOLD && _HasAvx2()) {
+		i = n & ~static_cast<size_t>(7);
+		borrow = _SubLimbsAvx2(a, b, i, borrow, out);
+	}
+#endif
+	for (; i < n; ++i) {
+		unsigned long long value = static_cast<unsigned long long>(a[i]) - b[i] - borrow;
+		out[i] = static_cast<unsigned int>(value);
+		borrow = static_cast<unsigned int>(value >> 63);
+	}
+	return borrow;
+}
+
+/*
+ * out = a + carry over n limbs. The carry dies out after a limb or two, the
+ * rest is a copy.
+ */
+unsigned int Bint::_AddCarry(const unsigned int *a, size_t n, unsigned int carry, unsigned int *out)
+{
+	size_t i = 0;
+	for (; i < n && carry != 0; ++i) {
+		out[i] = a[i] + 1;
+		carry = out[i] == 0;
+	}
+	if (out != a) {
+		memcpy(out + i, a + i, sizeof(unsigned int) * (n - i));
 	}
-	for (size_t i = 0; i < lhs.length; ++i) {
-		if (lhs.data[i] != rhs.data[i]) {
-			return false;
+	return carry;
+}
+
+unsigned int Bint::_SubBorrow(const unsigned int *a, size_t n, unsigned int borrow, unsigned int *out)
+{
+	size_t i = 0;
+	for (; i < n && borrow != 0; ++i) {
+		borrow = a[i] == 0;
+		out[i] = a[i] - 1;
+	}
+	if (out != a) {
+		memcpy(out + i, a + i, sizeof(unsigned int) * (n - i));
+	}
+	return borrow;
+}
+
+/*
+ * Compare a and b as n-limb magnitudes.
+ */
+int Bint::_CompareLimbs(const unsigned int *a, const unsigned int *b, size_t n)
+{
+#ifdef BINT_AVX2
+	if (n >= SIMD_THRESHOLD && _HasAvx2()) {
+		n = _MismatchAvx2(a, b, n);
+	}
+#endif
+	for (size_t i = n; i-- > 0;) {
+		if (a[i] != b[i]) {
+			return a[i] < b[i] ? -1 : 1;
 		}
 	}
-	return true;
+	return 0;
 }
 
-bool operator!=(const Bint &lhs, const Bint &rhs)
+#ifdef BINT_AVX2
+/*
+ * Eight limbs per step; n is a multiple of 8. Each lane's carry in is
+ * resolved from two bitmasks: lanes whose sum wrapped generate a carry, lanes
+ * that summed to all ones pass an incoming carry on. Adding the generate
+ * mask (shifted up one lane) to the propagate mask ripples every carry
+ * through its run of all-ones lanes in one scalar add.
+ */
+__attribute__((target("avx2")))
+unsigned int Bint::_AddLimbsAvx2(const unsigned int *a, const unsigned int *b, size_t n, unsigned int carry, unsigned int *out)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return true;
+	const __m256i sign = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+	const __m256i ones = _mm256_set1_epi32(-1);
+	const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	for (size_t i = 0; i < n; i += 8) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+		__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+		__m256i sum = _mm256_add_epi32(x, y);
+		__m256i wrapped = _mm256_cmpgt_epi32(_mm256_xor_si256(x, sign), _mm256_xor_si256(sum, sign));
+		unsigned int generate = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(wrapped)));
+		unsigned int propagate = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(sum, ones))));
+		unsigned int carries = ((generate << 1) | carry) + propagate;
+		carry = carries >> 8;
+		carries = (carries ^ propagate) & 0xff;
+		__m256i increment = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<int>(carries)), lanes), lanes);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_sub_epi32(sum, increment));
 	}
-	if (lhs.length != rhs.length) {
-		return true;
+	return carry;
+}
+
+/*
+ * Same scheme as _AddLimbsAvx2: lanes where b > a generate a borrow, lanes
+ * whose difference is zero pass one on.
+ */
+__attribute__((target("avx2")))
+unsigned int Bint::_SubLimbsAvx2(const unsigned int *a, const unsigned int *b, size_t n, unsigned int borrow, unsigned int *out)
+{
+	const __m256i sign = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	for (size_t i = 0; i < n; i += 8) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+		__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+		__m256i difference = _mm256_sub_epi32(x, y);
+		__m256i wrapped = _mm256_cmpgt_epi32(_mm256_xor_si256(y, sign), _mm256_xor_si256(x, sign));
+		unsigned int generate = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(wrapped)));
+		unsigned int propagate = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(difference, zero))));
+		unsigned int borrows = ((generate << 1) | borrow) + propagate;
+		borrow = borrows >> 8;
+		borrows = (borrows ^ propagate) & 0xff;
+		__m256i decrement = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<int>(borrows)), lanes), lanes);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_add_epi32(difference, decrement));
 	}
-	for (size_t i = 0; i < lhs.length; ++i) {
-		if (lhs.data[i] != rhs.data[i]) {
-			return true;
+	return borrow;
+}
+
+/*
+ * Scan down from the top eight limbs at a time; returns how many low limbs
+ * still have to be compared, i.e. one past the highest block that differs.
+ */
+__attribute__((target("avx2")))
+size_t Bint::_MismatchAvx2(const unsigned int *a, const unsigned int *b, size_t n)
+{
+	while (n >= 8) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + n - 8));
+		__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + n - 8));
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(x, y)) != -1) {
+			return n;
 		}
+		n -= 8;
 	}
-	return false;
+	return n;
 }
+#endif
 
-bool operator<(const Bint &lhs, const Bint &rhs)
+/*
+ * lhs + rhs with rhs's sign taken to be rhsMinus, so subtraction needs no
+ * negated copy.
+ */
+Bint Bint::_AddSigned(const Bint &lhs, const Bint &rhs, bool rhsMinus)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return !lhs.isMinus;
+	if (lhs.isMinus == rhsMinus) {
+		const Bint &longer = lhs.length >= rhs.length ? lhs : rhs;
+		const Bint &shorter = lhs.length >= rhs.length ? rhs : lhs;
+		Bint result(longer.length + 1);
+		unsigned int carry = _AddLimbs(longer.data, shorter.data, shorter.length, 0, result.data);
+		carry = _AddCarry(longer.data + shorter.length, longer.length - shorter.length, carry, result.data + shorter.length);
+		result.data[longer.length] = carry;
+		result.length = longer.length + 1;
+		result.isMinus = lhs.isMinus;
+		result._Shrink();
+		return result;
 	}
-	if (lhs.isMinus) {
-		if (lhs.length != rhs.length) {
-			return lhs.length > rhs.length;
+	int order = _CompareAbs(lhs, rhs);
+	if (order == 0) {
+		return Bint();
+	}
+	const Bint &larger = order > 0 ? lhs : rhs;
+	const Bint &smaller = order > 0 ? rhs : lhs;
+	Bint result(larger.length);
+	unsigned int borrow = _SubLimbs(larger.data, smaller.data, smaller.length, 0, result.data);
+	_SubBorrow(larger.data + smaller.length, larger.length - smaller.length, borrow, result.data + smaller.length);
+	result.length = larger.length;
+	result.isMinus = order > 0 ? lhs.isMinus : rhsMinus;
+	result._Shrink();
+	return result;
+}
+
+/*
+ * In-place form of _AddSigned; rhs may be *this. Only allocates when the
+ * result needs more limbs than the buffer has.
+ */
+void Bint::_AddInPlace(const Bint &rhs, bool rhsMinus)
+{
+	size_t rhsLength = rhs.length;
+	if (isMinus == rhsMinus) {
+		size_t n = std::max(length, rhsLength);
+		_Reserve(n, true);
+		unsigned int carry;
+		if (length >= rhsLength) {
+			carry = _AddLimbs(data, rhs.data, rhsLength, 0, data);
+			carry = _AddCarry(data + rhsLength, length - rhsLength, carry, data + rhsLength);
+		} else {
+			carry = _AddLimbs(data, rhs.data, length, 0, data);
+			carry = _AddCarry(rhs.data + length, rhsLength - length, carry, data + length);
 		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] > rhs.data[i];
-			}
+		length = n;
+		if (carry != 0) {
+			_Reserve(n + 1, true);
+			data[length++] = static_cast<unsigned int>(carry);
 		}
-		return false;
+		return;
+	}
+	int order = _CompareAbs(*this, rhs);
+	if (order == 0) {
+		_Assign(0, false);
+		return;
+	}
+	if (order > 0) {
+		unsigned int borrow = _SubLimbs(data, rhs.data, rhsLength, 0, data);
+		_SubBorrow(data + rhsLength, length - rhsLength, borrow, data + rhsLength);
 	} else {
-		if (lhs.length != rhs.length) {
-			return lhs.length < rhs.length;
+		_Reserve(rhsLength, true);
+		unsigned int borrow = _SubLimbs(rhs.data, data, length, 0, data);
+		_SubBorrow(rhs.data + length, rhsLength - length, borrow, data + length);
+		length = rhsLength;
+		isMinus = rhsMinus;
+	}
+	_Shrink();
+}
+
+Bint &Bint::operator+=(const Bint &rhs)
+{
+	_AddInPlace(rhs, rhs.isMinus);
+	return *this;
+}
+
+Bint &Bint::operator-=(const Bint &rhs)
+{
+	_AddInPlace(rhs, !rhs.isMinus);
+	return *this;
+}
+
+Bint operator+(const Bint &lhs, const Bint &rhs)
+{
+	return Bint::_AddSigned(lhs, rhs, rhs.isMinus);
+}
+
+/*
+ * Overloads on temporaries reuse the temporary's buffer, so a chain such as
+ * a * b + c allocates once for the product and not again for the sum.
+ */
+Bint operator+(Bint &&lhs, const Bint &rhs)
+{
+	lhs += rhs;
+	return std::move(lhs);
+}
+
+Bint operator+(const Bint &lhs, Bint &&rhs)
+{
+	rhs += lhs;
+	return std::move(rhs);
+}
+
+Bint operator+(Bint &&lhs, Bint &&rhs)
+{
+	lhs += rhs;
+	return std::move(lhs);
+}
+
+Bint operator-(const Bint &b)
+{
+	Bint result(b);
+	if (result.length > 1 || result.data[0] != 0) {
+		result.isMinus = !result.isMinus;
+	}
+	return result;
+}
+
+Bint operator-(Bint &&b)
+{
+	if (b.length > 1 || b.data[0] != 0) {
+		b.isMinus = !b.isMinus;
+	}
+	return std::move(b);
+}
+
+Bint operator-(const Bint &lhs, const Bint &rhs)
+{
+	return Bint::_AddSigned(lhs, rhs, !rhs.isMinus);
+}
+
+Bint operator-(Bint &&lhs, const Bint &rhs)
+{
+	lhs -= rhs;
+	return std::move(lhs);
+}
+
+/*
+ * Carry every limb but the last into [0, Base); the last one keeps the sign
+ * and whatever is left.
+ */
+template<long long Base>
+void Bint::_Normalize(long long *x, size_t n)
+{
+	for (size_t i = 0; i + 1 < n; ++i) {
+		long long carry = x[i] / Base;
+		x[i] -= carry * Base;
+		if (x[i] < 0) {
+			x[i] += Base;
+			--carry;
 		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] < rhs.data[i];
-			}
+		x[i + 1] += carry;
+	}
+}
+
+/*
+ * Divide by d in place; the number must be a multiple of d.
+ */
+template<long long Base>
+void Bint::_ExactDivide(long long *x, size_t n, long long d)
+{
+	long long rest = 0;
+	for (size_t i = n; i-- > 0;) {
+		long long value = x[i] + rest * Base;
+		x[i] = value / d;
+		rest = value - x[i] * d;
+	}
+}
+
+/*
+ * out += sign * x * Base^shift with shift < n. Limbs of x that land past out[n - 1] are
+ * folded into it, which is exact as long as the sum still fits in n limbs.
+ */
+template<long long Base>
+void Bint::_AddShifted(long long *out, size_t n, const long long *x, size_t m, size_t shift, long long sign)
+{
+	long long high = 0;
+	for (size_t i = m; i-- > 0;) {
+		if (shift + i >= n) {
+			high = high * Base + x[i];
+		} else if (shift + i == n - 1) {
+			out[n - 1] += sign * (high * Base + x[i]);
+			high = 0;
+		} else {
+			out[shift + i] += sign * x[i];
 		}
-		return false;
 	}
 }
 
-bool operator>(const Bint &lhs, const Bint &rhs)
+void Bint::_MulSchoolbook(const long long *a, size_t na, const long long *b, size_t nb, long long *out)
 {
-	return rhs < lhs;
+	memset(out, 0, sizeof(long long) * (na + nb));
+	for (size_t i = 0; i < na; ++i) {
+		const long long ai = a[i];
+		long long *row = out + i;
+		for (size_t j = 0; j < nb; ++j) {
+			row[j] += ai * b[j];
+		}
+	}
 }
 
-bool operator<=(const Bint &lhs, const Bint &rhs)
+/*
+ * Needs na >= nb > (na + 1) / 2.
+ */
+template<long long Base>
+void Bint::_MulKaratsuba(const long long *a, size_t na, const long long *b, size_t nb, long long *out)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return !lhs.isMinus;
+	size_t k = (na + 1) >> 1, n = na + nb;
+	std::vector<long long> sa(k + 1, 0), sb(k + 1, 0), mid(2 * k + 2);
+	for (size_t i = 0; i < k; ++i) {
+		sa[i] = a[i] + (k + i < na ? a[k + i] : 0);
+		sb[i] = b[i] + (k + i < nb ? b[k + i] : 0);
+	}
+	_Normalize<Base>(&sa[0], k + 1);
+	_Normalize<Base>(&sb[0], k + 1);
+	_Multiply<Base>(&sa[0], k + 1, &sb[0], k + 1, &mid[0]);
+
+	std::vector<long long> low(2 * k), high(n - 2 * k);
+	_Multiply<Base>(a, k, b, k, &low[0]);
+	_Multiply<Base>(a + k, na - k, b + k, nb - k, &high[0]);
+	_AddShifted<Base>(&mid[0], mid.size(), &low[0], low.size(), 0, -1);
+	_AddShifted<Base>(&mid[0], mid.size(), &high[0], high.size(), 0, -1);
+	_Normalize<Base>(&mid[0], mid.size());
+
+	memset(out, 0, sizeof(long long) * n);
+	_AddShifted<Base>(out, n, &low[0], low.size(), 0, 1);
+	_AddShifted<Base>(out, n, &high[0], high.size(), 2 * k, 1);
+	_AddShifted<Base>(out, n, &mid[0], mid.size(), k, 1);
+	_Normalize<Base>(out, n);
+}
+
+/*
+ * Toom-3 at 0, 1, -1, -2 and infinity with Bodrato's interpolation.
+ * Needs na >= nb > 2 * ceil(na / 3).
+ */
+template<long long Base>
+void Bint::_MulToom3(const long long *a, size_t na, const long long *b, size_t nb, long long *out)
+{
+	size_t k = (na + 2) / 3, n = na + nb, len = k + 2, rlen = 2 * len;
+	std::vector<long long> eval(6 * len, 0);
+	long long *p1 = &eval[0], *pm1 = p1 + len, *pm2 = pm1 + len;
+	long long *q1 = pm2 + len, *qm1 = q1 + len, *qm2 = qm1 + len;
+	for (size_t i = 0; i < k; ++i) {
+		long long a0 = a[i], a1 = a[k + i], a2 = 2 * k + i < na ? a[2 * k + i] : 0;
+		long long b0 = b[i], b1 = b[k + i], b2 = 2 * k + i < nb ? b[2 * k + i] : 0;
+		p1[i] = a0 + a1 + a2;
+		pm1[i] = a0 - a1 + a2;
+		pm2[i] = a0 - 2 * a1 + 4 * a2;
+		q1[i] = b0 + b1 + b2;
+		qm1[i] = b0 - b1 + b2;
+		qm2[i] = b0 - 2 * b1 + 4 * b2;
+	}
+	for (size_t i = 0; i < 6; ++i) {
+		_Normalize<Base>(&eval[i * len], len);
+	}
+
+	std::vector<long long> r(5 * rlen, 0);
+	long long *r0 = &r[0], *r1 = r0 + rlen, *r2 = r1 + rlen, *r3 = r2 + rlen, *rinf = r3 + rlen;
+	_Multiply<Base>(a, k, b, k, r0);
+	_Multiply<Base>(a + 2 * k, na - 2 * k, b + 2 * k, nb - 2 * k, rinf);
+	_Multiply<Base>(p1, len, q1, len, r1);
+	_Multiply<Base>(pm1, len, qm1, len, r2);
+	_Multiply<Base>(pm2, len, qm2, len, r3);
+
+	// r1 = v(1), r2 = v(-1), r3 = v(-2) on entry.
+	for (size_t i = 0; i < rlen; ++i) {
+		r3[i] -= r1[i];
+		r1[i] -= r2[i];
+		r2[i] -= r0[i];
 	}
-	if (lhs.isMinus) {
-		if (lhs.length != rhs.length) {
-			return lhs.length > rhs.length;
+	_ExactDivide<Base>(r3, rlen, 3);
+	_ExactDivide<Base>(r1, rlen, 2);
+	for (size_t i = 0; i < rlen; ++i) {
+		r3[i] = r2[i] - r3[i];
+	}
+	_ExactDivide<Base>(r3, rlen, 2);
+	for (size_t i = 0; i < rlen; ++i) {
+		r3[i] += 2 * rinf[i];
+		r2[i] += r1[i] - rinf[i];
+		r1[i] -= r3[i];
+	}
+	_Normalize<Base>(r1, rlen);
+	_Normalize<Base>(r2, rlen);
+	_Normalize<Base>(r3, rlen);
+
+	memset(out, 0, sizeof(long long) * n);
+	_AddShifted<Base>(out, n, r0, 2 * k, 0, 1);
+	_AddShifted<Base>(out, n, rinf, n - 4 * k, 4 * k, 1);
+	_AddShifted<Base>(out, n, r1, rlen, k, 1);
+	_AddShifted<Base>(out, n, r2, rlen, 2 * k, 1);
+	_AddShifted<Base>(out, n, r3, rlen, 3 * k, 1);
+	_Normalize<Base>(out, n);
+}
+
+unsigned int Bint::_PowMod(unsigned long long base, unsigned long long exp, unsigned int mod)
+{
+	unsigned long long result = 1;
+	base %= mod;
+	for (; exp > 0; exp >>= 1) {
+		if (exp & 1) {
+			result = result * base % mod;
 		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] > rhs.data[i];
-			}
+		base = base * base % mod;
+	}
+	return static_cast<unsigned int>(result);
+}
+
+/*
+ * In-place transform of length n (a power of two) modulo a prime of the form
+ * c * 2^k + 1 with primitive root 3. The inverse includes the 1 / n scaling.
+ */
+void Bint::_Ntt(unsigned int *x, size_t n, unsigned int mod, bool inverse)
+{
+	for (size_t i = 1, j = 0; i < n; ++i) {
+		size_t bit = n >> 1;
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
 		}
-		return true;
-	} else {
-		if (lhs.length != rhs.length) {
-			return lhs.length < rhs.length;
+		j |= bit;
+		if (i < j) {
+			std::swap(x[i], x[j]);
 		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] < rhs.data[i];
+	}
+	std::vector<unsigned int> roots(n >> 1);
+	for (size_t len = 2; len <= n; len <<= 1) {
+		size_t half = len >> 1;
+		unsigned long long step = _PowMod(3, (mod - 1) / len, mod);
+		if (inverse) {
+			step = _PowMod(step, mod - 2, mod);
+		}
+		roots[0] = 1;
+		for (size_t j = 1; j < half; ++j) {
+			roots[j] = static_cast<unsigned int>(roots[j - 1] * step % mod);
+		}
+		for (size_t i = 0; i < n; i += len) {
+			unsigned int *lo = x + i, *hi = x + i + half;
+			for (size_t j = 0; j < half; ++j) {
+				unsigned int u = lo[j];
+				unsigned int v = static_cast<unsigned int>(static_cast<unsigned long long>(hi[j]) * roots[j] % mod);
+				lo[j] = u + v >= mod ? u + v - mod : u + v;
+				hi[j] = u >= v ? u - v : u + mod - v;
 			}
 		}
-		return true;
+	}
+	if (inverse) {
+		unsigned long long scale = _PowMod(n, mod - 2, mod);
+		for (size_t i = 0; i < n; ++i) {
+			x[i] = static_cast<unsigned int>(x[i] * scale % mod);
+		}
 	}
 }
 
-bool operator>=(const Bint &lhs, const Bint &rhs)
+/*
+ * Convolution modulo three NTT primes, recombined with Garner's algorithm.
+ * A coefficient is below min(na, nb) * Base^2 in magnitude, far inside the
+ * primes' product, so it is rebuilt exactly after shifting it by 2^62 to make
+ * it non-negative; the arithmetic wraps modulo 2^64, which is harmless once
+ * the shifted value is known to be below 2^63.
+ */
+void Bint::_MulNtt(const long long *a, size_t na, const long long *b, size_t nb, long long *out)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return lhs.isMinus;
+	static const unsigned int mods[3] = {998244353, 167772161, 469762049};
+	const unsigned long long offset = 1ULL << 62;
+	size_t n = 1;
+	while (n < na + nb) {
+		n <<= 1;
 	}
-	if (lhs.isMinus) {
-		if (lhs.length != rhs.length) {
-			return lhs.length < rhs.length;
+	std::vector<unsigned int> residue(3 * n);
+	std::vector<unsigned int> fb(n);
+	for (size_t k = 0; k < 3; ++k) {
+		const unsigned int mod = mods[k];
+		unsigned int *fa = &residue[k * n];
+		for (size_t i = 0; i < n; ++i) {
+			long long x = i < na ? a[i] % mod : 0;
+			long long y = i < nb ? b[i] % mod : 0;
+			fa[i] = static_cast<unsigned int>(x < 0 ? x + mod : x);
+			fb[i] = static_cast<unsigned int>(y < 0 ? y + mod : y);
 		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] < rhs.data[i];
-			}
+		_Ntt(fa, n, mod, false);
+		_Ntt(&fb[0], n, mod, false);
+		for (size_t i = 0; i < n; ++i) {
+			fa[i] = static_cast<unsigned int>(static_cast<unsigned long long>(fa[i]) * fb[i] % mod);
 		}
-		return true;
+		_Ntt(fa, n, mod, true);
+	}
+
+	const unsigned long long m0 = mods[0], m1 = mods[1], m2 = mods[2];
+	const unsigned long long inv01 = _PowMod(m0, m1 - 2, m1);
+	const unsigned long long inv012 = _PowMod(m0 * m1 % m2, m2 - 2, m2);
+	const unsigned long long m01 = m0 * m1;
+	for (size_t i = 0; i < na + nb; ++i) {
+		unsigned long long r0 = (residue[i] + offset % m0) % m0;
+		unsigned long long r1 = (residue[n + i] + offset % m1) % m1;
+		unsigned long long r2 = (residue[2 * n + i] + offset % m2) % m2;
+		unsigned long long t1 = (r1 + m1 - r0 % m1) % m1 * inv01 % m1;
+		unsigned long long x01 = (r0 + m0 * t1) % m2;
+		unsigned long long t2 = (r2 + m2 - x01) % m2 * inv012 % m2;
+		out[i] = static_cast<long long>(r0 + m0 * t1 + m01 * t2 - offset);
+	}
+}
+
+/*
+ * out[0, na + nb) = a * b, not necessarily normalized. Lopsided operands are
+ * cut into pieces of the shorter length first.
+ */
+template<long long Base>
+void Bint::_Multiply(const long long *a, size_t na, const long long *b, size_t nb, long long *out)
+{
+	if (na < nb) {
+		std::swap(a, b);
+		std::swap(na, nb);
+	}
+	if (nb < KARATSUBA_THRESHOLD) {
+		_MulSchoolbook(a, na, b, nb, out);
+	} else if (nb >= NTT_THRESHOLD && na + nb <= NTT_MAX_LENGTH) {
+		_MulNtt(a, na, b, nb, out);
+	} else if (nb <= (na + 1) >> 1) {
+		std::vector<long long> piece(2 * nb);
+		memset(out, 0, sizeof(long long) * (na + nb));
+		for (size_t i = 0; i < na; i += nb) {
+			size_t len = std::min(nb, na - i);
+			_Multiply<Base>(a + i, len, b, nb, &piece[0]);
+			_AddShifted<Base>(out, na + nb, &piece[0], len + nb, i, 1);
+		}
+		_Normalize<Base>(out, na + nb);
+	} else if (nb >= TOOM3_THRESHOLD && nb > 2 * ((na + 2) / 3)) {
+		_MulToom3<Base>(a, na, b, nb, out);
 	} else {
-		if (lhs.length != rhs.length) {
-			return lhs.length > rhs.length;
+		_MulKaratsuba<Base>(a, na, b, nb, out);
+	}
+}
+
+size_t Bint::_Significant(const long long *x, size_t n)
+{
+	while (n > 1 && x[n - 1] == 0) {
+		--n;
+	}
+	return n;
+}
+
+void Bint::_ToHalves(const unsigned int *x, size_t n, long long *out)
+{
+	for (size_t i = 0; i < n; ++i) {
+		out[i << 1] = x[i] & 0xFFFF;
+		out[i << 1 | 1] = x[i] >> 16;
+	}
+}
+
+/*
+ * Packs n normalized base-65536 digits into (n + 1) / 2 limbs.
+ */
+void Bint::_FromHalves(const long long *x, size_t n, unsigned int *out)
+{
+	for (size_t i = 0; i < n; i += 2) {
+		out[i >> 1] = static_cast<unsigned int>(x[i]);
+		if (i + 1 < n) {
+			out[i >> 1] |= static_cast<unsigned int>(x[i + 1]) << 16;
 		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] > rhs.data[i];
+	}
+}
+
+/*
+ * Base 65536 to base 10000, out needs m >= n + n / 4 + 1 digits.
+ * Splits off the low half = 2^level digits: x = high * 65536^half + low,
+ * with powers[level] = 65536^(2^level) in base 10000 built once per call
+ * tree by squaring.
+ */
+void Bint::_ToDecimal(const long long *x, size_t n, long long *out, size_t m, std::vector<std::vector<long long> > &powers)
+{
+	memset(out, 0, sizeof(long long) * m);
+	if (n <= CONVERSION_THRESHOLD) {
+		size_t used = 1;
+		for (size_t i = n; i-- > 0;) {
+			long long carry = x[i];
+			for (size_t j = 0; j < used; ++j) {
+				long long value = out[j] * 65536 + carry;
+				out[j] = value % 10000;
+				carry = value / 10000;
+			}
+			for (; carry > 0; carry /= 10000) {
+				out[used++] = carry % 10000;
 			}
 		}
-		return true;
+		return;
 	}
+	size_t level = 0;
+	while ((size_t(2) << level) < n) {
+		++level;
+	}
+	while (powers.size() <= level) {
+		if (powers.empty()) {
+			powers.push_back(std::vector<long long>{5536, 6});
+			continue;
+		}
+		std::vector<long long> square(powers.back().size() << 1);
+		_Multiply<10000>(&powers.back()[0], powers.back().size(), &powers.back()[0], powers.back().size(), &square[0]);
+		_Normalize<10000>(&square[0], square.size());
+		square.resize(_Significant(&square[0], square.size()));
+		powers.push_back(square);
+	}
+	size_t half = size_t(1) << level, highN = n - half, highM = highN + (highN >> 2) + 1;
+	std::vector<long long> high(highM);
+	_ToDecimal(x + half, highN, &high[0], highM, powers);
+	_ToDecimal(x, half, out, half + (half >> 2) + 1, powers);
+	highM = _Significant(&high[0], highM);
+	const std::vector<long long> &power = powers[level];
+	std::vector<long long> product(highM + power.size());
+	_Multiply<10000>(&high[0], highM, &power[0], power.size(), &product[0]);
+	_AddShifted<10000>(out, m, &product[0], product.size(), 0, 1);
+	_Normalize<10000>(out, m);
 }
 
-
-Bint operator+(const Bint &lhs, const Bint &rhs)
+/*
+ * Base 10000 to base 65536, out needs m >= n - n / 8 + 1 digits. Mirrors
+ * _ToDecimal with powers[level] = 10000^(2^level) in base 65536.
+ */
+void Bint::_FromDecimal(const long long *x, size_t n, long long *out, size_t m, std::vector<std::vector<long long> > &powers)
 {
-	if (lhs.isMinus == rhs.isMinus) {
-		size_t maxLen = std::max(lhs.length, rhs.length);
-		size_t expectLen = maxLen + 1;
-		Bint result(expectLen); // special constructor
-		for (size_t i = 0; i < maxLen; ++i) {
-			result.data[i] = lhs.data[i] + rhs.data[i];
-		}
-		for (size_t i = 0; i < maxLen; ++i) {
-			if (result.data[i] > 10000) {
-				result.data[i] -= 10000;
-				++result.data[i + 1];
+	memset(out, 0, sizeof(long long) * m);
+	if (n <= CONVERSION_THRESHOLD) {
+		size_t used = 1;
+		for (size_t i = n; i-- > 0;) {
+			long long carry = x[i];
+			for (size_t j = 0; j < used; ++j) {
+				long long value = out[j] * 10000 + carry;
+				out[j] = value & 0xFFFF;
+				carry = value >> 16;
+			}
+			for (; carry > 0; carry >>= 16) {
+				out[used++] = carry & 0xFFFF;
 			}
 		}
-		result.length = result.data[maxLen] > 0 ? maxLen + 1 : maxLen;
-		result.isMinus = lhs.isMinus;
-		return result;
+		return;
+	}
+	size_t level = 0;
+	while ((size_t(2) << level) < n) {
+		++level;
+	}
+	while (powers.size() <= level) {
+		if (powers.empty()) {
+			powers.push_back(std::vector<long long>(1, 10000));
+			continue;
+		}
+		std::vector<long long> square(powers.back().size() << 1);
+		_Multiply<65536>(&powers.back()[0], powers.back().size(), &powers.back()[0], powers.back().size(), &square[0]);
+		_Normalize<65536>(&square[0], square.size());
+		square.resize(_Significant(&square[0], square.size()));
+		powers.push_back(square);
+	}
+	size_t half = size_t(1) << level, highN = n - half, highM = highN - (highN >> 3) + 1;
+	std::vector<long long> high(highM);
+	_FromDecimal(x + half, highN, &high[0], highM, powers);
+	_FromDecimal(x, half, out, half - (half >> 3) + 1, powers);
+	highM = _Significant(&high[0], highM);
+	const std::vector<long long> &power = powers[level];
+	std::vector<long long> product(highM + power.size());
+	_Multiply<65536>(&high[0], highM, &power[0], power.size(), &product[0]);
+	_AddShifted<65536>(out, m, &product[0], product.size(), 0, 1);
+	_Normalize<65536>(out, m);
+}
+
+/*
+ * out = lhs * rhs; out may alias either operand. Short operands are
+ * multiplied limb by limb in out's own buffer, from the top limb of lhs
+ * down so each limb is read before the partial product overwrites it.
+ * Longer ones go through the half-limb kernels.
+ */
+void Bint::_MultiplyInto(const Bint &lhs, const Bint &rhs, Bint &out)
+{
+	if (&out == &rhs && &out != &lhs) {
+		_MultiplyInto(rhs, lhs, out);
+		return;
+	}
+	size_t la = lhs.length, lb = rhs.length, n = la + lb;
+	bool minus = lhs.isMinus != rhs.isMinus;
+	if (std::min(la, lb) >= SCHOOLBOOK_THRESHOLD) {
+		size_t na = la << 1, nb = lb << 1;
+		std::vector<long long> a(na), b(nb), product(na + nb);
+		_ToHalves(lhs.data, la, &a[0]);
+		_ToHalves(rhs.data, lb, &b[0]);
+		na = _Significant(&a[0], na);
+		nb = _Significant(&b[0], nb);
+		_Multiply<65536>(&a[0], na, &b[0], nb, &product[0]);
+		_Normalize<65536>(&product[0], na + nb);
+		out._Reserve(n, false);
+		memset(out.data, 0, sizeof(unsigned int) * n);
+		_FromHalves(&product[0], na + nb, out.data);
+	} else if (&lhs == &rhs) {
+		Bint copy(rhs);
+		_MultiplyInto(lhs, copy, out);
+		return;
 	} else {
-		if (lhs.isMinus) {
-			return rhs - abs(lhs);
+		if (&out == &lhs) {
+			out._Reserve(n, true);
 		} else {
-			return lhs - abs(rhs);
+			out._Reserve(n, false);
+			memcpy(out.data, lhs.data, sizeof(unsigned int) * la);
+		}
+		memset(out.data + la, 0, sizeof(unsigned int) * lb);
+		unsigned int *r = out.data;
+		const unsigned int *b = rhs.data;
+		for (size_t i = la; i-- > 0;) {
+			unsigned long long x = r[i], carry = 0;
+			r[i] = 0;
+			for (size_t j = 0; j < lb; ++j) {
+				carry += x * b[j] + r[i + j];
+				r[i + j] = static_cast<unsigned int>(carry);
+				carry >>= 32;
+			}
+			for (size_t k = i + lb; carry != 0; ++k) {
+				carry += r[k];
+				r[k] = static_cast<unsigned int>(carry);
+				carry >>= 32;
+			}
 		}
 	}
+	out.length = n;
+	out.isMinus = minus;
+	out._Shrink();
 }
 
-Bint operator-(const Bint &b)
+Bint &Bint::operator*=(const Bint &rhs)
 {
-	Bint result(b);
-	result.isMinus = !result.isMinus;
+	_MultiplyInto(*this, rhs, *this);
+	return *this;
+}
+
+Bint operator*(const Bint &lhs, const Bint &rhs)
+{
+	Bint result;
+	Bint::_MultiplyInto(lhs, rhs, result);
 	return result;
 }
 
-Bint operator-(Bint &&b)
+Bint operator*(Bint &&lhs, const Bint &rhs)
 {
-	b.isMinus = !b.isMinus;
-	return b;
+	lhs *= rhs;
+	return std::move(lhs);
 }
 
-Bint operator-(const Bint &lhs, const Bint &rhs)
+Bint Bint::_FromLimbs(const unsigned int *x, size_t n)
 {
-	if (lhs.isMinus == rhs.isMinus) {
-		if (lhs.isMinus) {
-			return -(abs(lhs) - abs(rhs));
-		} else {
-			if (lhs < rhs) {
-				return -(rhs - lhs);
+	Bint result(n);
+	memcpy(result.data, x, sizeof(unsigned int) * n);
+	result.length = n == 0 ? 1 : n;
+	result._Shrink();
+	return result;
+}
+
+Bint Bint::_ShiftLeft(const Bint &x, size_t bits)
+{
+	size_t limbs = bits >> 5, rest = bits & 31;
+	Bint result(x.length + limbs + 1);
+	for (size_t i = 0; i < x.length; ++i) {
+		unsigned long long value = static_cast<unsigned long long>(x.data[i]) << rest;
+		result.data[i + limbs] |= static_cast<unsigned int>(value);
+		result.data[i + limbs + 1] |= static_cast<unsigned int>(value >> 32);
+	}
+	result.length = x.length + limbs + 1;
+	result.isMinus = x.isMinus;
+	result._Shrink();
+	return result;
+}
+
+/*
+ * Shifts the magnitude, so negative values are truncated toward zero.
+ */
+Bint Bint::_ShiftRight(const Bint &x, size_t bits)
+{
+	size_t limbs = bits >> 5, rest = bits & 31;
+	if (limbs >= x.length) {
+		return Bint();
+	}
+	Bint result(x.length - limbs);
+	for (size_t i = limbs; i < x.length; ++i) {
+		unsigned long long value = x.data[i];
+		if (i + 1 < x.length) {
+			value |= static_cast<unsigned long long>(x.data[i + 1]) << 32;
+		}
+		result.data[i - limbs] = static_cast<unsigned int>(value >> rest);
+	}
+	result.length = x.length - limbs;
+	result.isMinus = x.isMinus;
+	result._Shrink();
+	return result;
+}
+
+/*
+ * Knuth's algorithm D, O(n * (m - n)) for an m-limb u and n-limb v.
+ */
+void Bint::_DivModKnuth(const Bint &u, const Bint &v, Bint &quotient, Bint &remainder)
+{
+	size_t m = u.length, n = v.length;
+	Bint q(m - n + 1), r(n);
+	if (n == 1) {
+		unsigned long long rest = 0;
+		for (size_t i = m; i-- > 0;) {
+			rest = rest << 32 | u.data[i];
+			q.data[i] = static_cast<unsigned int>(rest / v.data[0]);
+			rest %= v.data[0];
+		}
+		r.data[0] = static_cast<unsigned int>(rest);
+	} else {
+		// Scale so that the top limb of v has its high bit set; then each
+		// estimated quotient limb is at most two too large.
+		unsigned int shift = 0;
+		while (!((v.data[n - 1] << shift) & 0x80000000u)) {
+			++shift;
+		}
+		std::vector<unsigned int> vn(n), un(m + 1);
+		for (size_t i = n - 1; i > 0; --i) {
+			vn[i] = v.data[i] << shift | static_cast<unsigned int>(static_cast<unsigned long long>(v.data[i - 1]) >> (32 - shift));
+		}
+		vn[0] = v.data[0] << shift;
+		un[m] = static_cast<unsigned int>(static_cast<unsigned long long>(u.data[m - 1]) >> (32 - shift));
+		for (size_t i = m - 1; i > 0; --i) {
+			un[i] = u.data[i] << shift | static_cast<unsigned int>(static_cast<unsigned long long>(u.data[i - 1]) >> (32 - shift));
+		}
+		un[0] = u.data[0] << shift;
+
+		const unsigned long long base = 1ULL << 32;
+		for (size_t j = m - n + 1; j-- > 0;) {
+			unsigned long long top = static_cast<unsigned long long>(un[j + n]) << 32 | un[j + n - 1];
+			unsigned long long qhat = top / vn[n - 1], rhat = top % vn[n - 1];
+			while (qhat >= base || qhat * vn[n - 2] > (rhat << 32 | un[j + n - 2])) {
+				--qhat;
+				rhat += vn[n - 1];
+				if (rhat >= base) {
+					break;
+				}
 			}
-			Bint result(std::max(lhs.length, rhs.length));
-			for (size_t i = 0; i < lhs.length; ++i) {
-				result.data[i] = lhs.data[i] - rhs.data[i];
+			long long borrow = 0, diff;
+			for (size_t i = 0; i < n; ++i) {
+				unsigned long long product = qhat * vn[i];
+				diff = un[i + j] - borrow - static_cast<long long>(product & 0xFFFFFFFFu);
+				un[i + j] = static_cast<unsigned int>(diff);
+				borrow = static_cast<long long>(product >> 32) - (diff >> 32);
 			}
-			for (size_t i = 0; i < lhs.length; ++i) {
-				if (result.data[i] < 0) {
-					result.data[i] += 10000;
-					++result.data[i + 1];
+			diff = un[j + n] - borrow;
+			un[j + n] = static_cast<unsigned int>(diff);
+			q.data[j] = static_cast<unsigned int>(qhat);
+			if (diff < 0) {
+				--q.data[j];
+				unsigned long long carry = 0;
+				for (size_t i = 0; i < n; ++i) {
+					carry += static_cast<unsigned long long>(un[i + j]) + vn[i];
+					un[i + j] = static_cast<unsigned int>(carry);
+					carry >>= 32;
 				}
+				un[j + n] += static_cast<unsigned int>(carry);
 			}
-			while (result.length > 1 && result.data[result.length - 1] == 0) {
-				--result.length;
-			}
-			return result;
 		}
+		for (size_t i = 0; i < n; ++i) {
+			r.data[i] = un[i] >> shift | static_cast<unsigned int>(static_cast<unsigned long long>(un[i + 1]) << (32 - shift));
+		}
+	}
+	q.length = m - n + 1;
+	r.length = n;
+	q._Shrink();
+	r._Shrink();
+	quotient = std::move(q);
+	remainder = std::move(r);
+}
+
+/*
+ * 2^(64n) / v for an n-limb v whose top bit is set, rounded down and possibly
+ * a few units short. The reciprocal of the top half of v is refined by one
+ * Newton step, x += x * (2^(64n) - v * x) / 2^(64n), which approaches from
+ * below and doubles the number of correct limbs.
+ */
+Bint Bint::_Reciprocal(const Bint &v)
+{
+	size_t n = v.length;
+	Bint power = _ShiftLeft(Bint(1), 64 * n);
+	if (n <= NEWTON_THRESHOLD) {
+		Bint quotient, remainder;
+		_DivModKnuth(power, v, quotient, remainder);
+		return quotient;
+	}
+	size_t low = n >> 1;
+	Bint x = _ShiftLeft(_Reciprocal(_ShiftRight(v, 32 * low)), 32 * low);
+	return x + _ShiftRight(x * (power - v * x), 64 * n);
+}
+
+/*
+ * Divides n limbs at a time from the top with the reciprocal of v, so an
+ * m-limb u costs about 2 * m / n multiplications of n-limb numbers.
+ */
+void Bint::_DivModNewton(const Bint &u, const Bint &v, Bint &quotient, Bint &remainder)
+{
+	unsigned int shift = 0;
+	while (!((v.data[v.length - 1] << shift) & 0x80000000u)) {
+		++shift;
+	}
+	Bint un = _ShiftLeft(u, shift), vn = _ShiftLeft(v, shift);
+	size_t n = vn.length, blocks = (un.length + n - 1) / n;
+	Bint inverse = _Reciprocal(vn), rest;
+	Bint q(blocks * n);
+	const Bint one(1);
+	for (size_t i = blocks; i-- > 0;) {
+		Bint current = _ShiftLeft(rest, 32 * n) + _FromLimbs(un.data + i * n, std::min(n, un.length - i * n));
+		Bint digit = _ShiftRight(current * inverse, 64 * n);
+		rest = current - digit * vn;
+		while (rest.isMinus) {
+			rest += vn;
+			digit -= one;
+		}
+		while (_CompareAbs(rest, vn) >= 0) {
+			rest -= vn;
+			digit += one;
+		}
+		memcpy(q.data + i * n, digit.data, sizeof(unsigned int) * digit.length);
+	}
+	q.length = blocks * n;
+	q._Shrink();
+	quotient = std::move(q);
+	remainder = _ShiftRight(rest, shift);
+}
+
+void Bint::_DivModAbs(const Bint &u, const Bint &v, Bint &quotient, Bint &remainder)
+{
+	if (_CompareAbs(u, v) < 0) {
+		quotient = Bint();
+		remainder = abs(u);
+	} else if (v.length >= NEWTON_THRESHOLD && u.length - v.length >= NEWTON_THRESHOLD) {
+		_DivModNewton(abs(u), abs(v), quotient, remainder);
 	} else {
-		return lhs + (-rhs);
+		_DivModKnuth(u, v, quotient, remainder);
 	}
 }
 
-Bint operator*(const Bint &lhs, const Bint &rhs)
+/*
+ * Quotient rounded toward zero and a remainder with the sign of lhs, as for
+ * built-in integers.
+ */
+std::pair<Bint, Bint> divmod(const Bint &lhs, const Bint &rhs)
+{
+	if (rhs.length == 1 && rhs.data[0] == 0) {
+		throw Bint::DivideByZero();
+	}
+	Bint quotient, remainder;
+	Bint::_DivModAbs(lhs, rhs, quotient, remainder);
+	quotient.isMinus = lhs.isMinus != rhs.isMinus;
+	remainder.isMinus = lhs.isMinus;
+	quotient._Shrink();
+	remainder._Shrink();
+	return std::make_pair(std::move(quotient), std::move(remainder));
+}
+
+Bint operator/(const Bint &lhs, const Bint &rhs)
+{
+	return divmod(lhs, rhs).first;
+}
+
+Bint operator%(const Bint &lhs, const Bint &rhs)
+{
+	return divmod(lhs, rhs).second;
+}
+
+Bint pow(const Bint &base, unsigned long long exp)
 {
-	size_t expectLen = lhs.length + rhs.length + 2;
-	Bint result(expectLen);
-	for (size_t i = 0; i < lhs.length; ++i) {
-		for (size_t j = 0; j < rhs.length; ++j) {
-			long long tmp = result.data[i + j] + static_cast<long long>(lhs.data[i]) * rhs.data[j];
-			if (tmp >= 10000) {
-				result.data[i + j] = tmp % 10000;
-				result.data[i + j + 1] += static_cast<int>(tmp / 10000);
-			} else {
-				result.data[i + j] = tmp;
+	Bint result(1);
+	int top = 63;
+	while (top >= 0 && !(exp >> top & 1)) {
+		--top;
+	}
+	for (int bit = top; bit >= 0; --bit) {
+		if (bit != top) {
+			result *= result;
+		}
+		if (exp >> bit & 1) {
+			result *= base;
+		}
+	}
+	return result;
+}
+
+/*
+ * out = a * b / 2^(32n) mod m for a, b < m, where mInv = -m^-1 mod 2^32
+ * (CIOS Montgomery multiplication). t needs n + 2 limbs.
+ */
+void Bint::_MontgomeryMultiply(const unsigned int *a, const unsigned int *b, const unsigned int *m, size_t n, unsigned int mInv, unsigned int *t, unsigned int *out)
+{
+	memset(t, 0, sizeof(unsigned int) * (n + 2));
+	for (size_t i = 0; i < n; ++i) {
+		unsigned long long carry = 0;
+		for (size_t j = 0; j < n; ++j) {
+			carry += t[j] + static_cast<unsigned long long>(a[j]) * b[i];
+			t[j] = static_cast<unsigned int>(carry);
+			carry >>= 32;
+		}
+		carry += t[n];
+		t[n] = static_cast<unsigned int>(carry);
+		t[n + 1] = static_cast<unsigned int>(carry >> 32);
+		unsigned int factor = t[0] * mInv;
+		carry = (t[0] + static_cast<unsigned long long>(factor) * m[0]) >> 32;
+		for (size_t j = 1; j < n; ++j) {
+			carry += t[j] + static_cast<unsigned long long>(factor) * m[j];
+			t[j - 1] = static_cast<unsigned int>(carry);
+			carry >>= 32;
+		}
+		carry += t[n];
+		t[n - 1] = static_cast<unsigned int>(carry);
+		t[n] = t[n + 1] + static_cast<unsigned int>(carry >> 32);
+	}
+	bool reduce = t[n] != 0;
+	if (!reduce) {
+		reduce = true;
+		for (size_t i = n; i-- > 0;) {
+			if (t[i] != m[i]) {
+				reduce = t[i] > m[i];
+				break;
 			}
 		}
 	}
-	result.length = lhs.length + rhs.length -1;
-	while (result.data[result.length] > 0) {
-		++result.length;
+	unsigned long long borrow = 0;
+	for (size_t i = 0; i < n; ++i) {
+		unsigned long long value = static_cast<unsigned long long>(t[i]) - (reduce ? m[i] : 0) - borrow;
+		out[i] = static_cast<unsigned int>(value);
+		borrow = value >> 63;
+	}
+}
+
+/*
+ * x mod m for 0 <= x < m^2, with mu = floor(2^(64n) / m) for an n-limb m.
+ */
+Bint Bint::_BarrettReduce(const Bint &x, const Bint &m, const Bint &mu)
+{
+	size_t n = m.length;
+	Bint r = x - _ShiftRight(_ShiftRight(x, 32 * (n - 1)) * mu, 32 * (n + 1)) * m;
+	while (_CompareAbs(r, m) >= 0) {
+		r = r - m;
+	}
+	return r;
+}
+
+/*
+ * base^exp mod |mod|, in [0, |mod|). Odd moduli below MONTGOMERY_THRESHOLD
+ * limbs multiply in Montgomery form; the rest use Barrett reduction, which
+ * goes through the fast multiplication.
+ */
+Bint powmod(const Bint &base, const Bint &exp, const Bint &mod)
+{
+	if (mod.length == 1 && mod.data[0] == 0) {
+		throw Bint::DivideByZero();
+	}
+	if (exp.isMinus) {
+		throw Bint::NegativeExponent();
+	}
+	Bint m = abs(mod);
+	if (m.length == 1 && m.data[0] == 1) {
+		return Bint();
 	}
-	while (result.length > 1 && result.data[result.length - 1] == 0) {
-		--result.length;
+	Bint b = base % m;
+	if (b.isMinus) {
+		b = b + m;
+	}
+	size_t top = exp.length * 32;
+	while (top > 0 && !(exp.data[(top - 1) >> 5] >> ((top - 1) & 31) & 1)) {
+		--top;
+	}
+
+	size_t n = m.length;
+	if ((m.data[0] & 1) && n < MONTGOMERY_THRESHOLD) {
+		unsigned int inverse = m.data[0];
+		for (int i = 0; i < 4; ++i) {
+			inverse *= 2 - m.data[0] * inverse;
+		}
+		Bint baseForm = Bint::_ShiftLeft(b, 32 * n) % m, oneForm = Bint::_ShiftLeft(Bint(1), 32 * n) % m;
+		std::vector<unsigned int> x(n, 0), power(n, 0), one(n, 0), t(n + 2), next(n);
+		memcpy(&x[0], oneForm.data, sizeof(unsigned int) * oneForm.length);
+		memcpy(&power[0], baseForm.data, sizeof(unsigned int) * baseForm.length);
+		one[0] = 1;
+		for (size_t bit = top; bit-- > 0;) {
+			Bint::_MontgomeryMultiply(&x[0], &x[0], m.data, n, 0u - inverse, &t[0], &next[0]);
+			x.swap(next);
+			if (exp.data[bit >> 5] >> (bit & 31) & 1) {
+				Bint::_MontgomeryMultiply(&x[0], &power[0], m.data, n, 0u - inverse, &t[0], &next[0]);
+				x.swap(next);
+			}
+		}
+		Bint::_MontgomeryMultiply(&x[0], &one[0], m.data, n, 0u - inverse, &t[0], &next[0]);
+		return Bint::_FromLimbs(&next[0], n);
+	}
+
+	Bint mu = Bint::_ShiftLeft(Bint(1), 64 * n) / m, result(1);
+	for (size_t bit = top; bit-- > 0;) {
+		result = Bint::_BarrettReduce(result * result, m, mu);
+		if (exp.data[bit >> 5] >> (bit & 31) & 1) {
+			result = Bint::_BarrettReduce(result * b, m, mu);
+		}
 	}
 	return result;
 }
 
 Bint::~Bint()
 {
-	if (data != nullptr) {
-		delete[] data;
-		data = nullptr;
-	}
+	_Release();
 }
 }
@@ -5,55 +5,497 @@
 #include <iomanip>
 #include <vector>
 #include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DIAMOND_MATRIX_SIMD
+#include <immintrin.h>
+#endif
 
 namespace Diamond {
 
+namespace detail {
+
+/**
+ * Work-stealing pool behind the parallel Matrix operations. Each ParallelFor
+ * call cuts its range into pieces and owns a Chase-Lev deque of their
+ * indices: the calling thread pops from the bottom while idle workers steal
+ * from the top, with the memory orderings of Le, Pop, Cohen and Zappa
+ * Nardelli (PPoPP 2013). Batches are published in a few slots that workers
+ * scan, so no lock is taken on the way from a piece to a thread. The caller
+ * spins until the last stolen piece has finished.
+ */
+class ThreadPool {
+	struct Batch {
+		const std::function<void(size_t, size_t)> *body;
+		size_t n, pieces;
+		char padding0[64];
+		std::atomic<long long> top;
+		char padding1[64];
+		std::atomic<long long> bottom;
+		char padding2[64];
+		std::atomic<size_t> remaining;
+		std::atomic<bool> failed;
+		std::exception_ptr error;
+
+		Batch(const std::function<void(size_t, size_t)> *_body, const size_t &_n, const size_t &_pieces)
+			: body(_body), n(_n), pieces(_pieces), top(0), bottom(static_cast<long long>(_pieces)), remaining(_pieces), failed(false) {}
+		/**
+		 * Calling thread only; takes the last unclaimed piece.
+		 */
+		bool Pop(size_t &index)
+		{
+			long long b = bottom.load(std::memory_order_relaxed) - 1;
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			long long t = top.load(std::memory_order_relaxed);
+			if (t > b) {
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return false;
+			}
+			if (t == b) {
+				bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				bottom.store(b + 1, std::memory_order_relaxed);
+				if (!won) {
+					return false;
+				}
+			}
+			index = static_cast<size_t>(b);
+			return true;
+		}
+		/**
+		 * Any thread; takes the first unclaimed piece, false on a lost race.
+		 */
+		bool Steal(size_t &index)
+		{
+			long long t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			long long b = bottom.load(std::memory_order_acquire);
+			if (t >= b || !top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				return false;
+			}
+			index = static_cast<size_t>(t);
+			return true;
+		}
+	};
+	/**
+	 * A published batch. A worker counts itself in visitors while it looks at
+	 * the batch, and the owner waits for that count to drop after clearing
+	 * the slot, so the batch can live on the owner's stack.
+	 */
+	struct Slot {
+		std::atomic<Batch *> batch;
+		std::atomic<size_t> visitors;
+		char padding[64];
+	};
+	static const size_t SLOTS = 16;
+
+	size_t n_workers;
+	Slot slots[SLOTS];
+	std::vector<std::thread> workers;
+	std::atomic<size_t> queued;
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	bool stopping = false;
+
+	static ThreadPool *& Current()
+	{
+		static thread_local ThreadPool *current = nullptr;
+		return current;
+	}
+	static void Run(Batch &batch, const size_t &index)
+	{
+		try {
+			(*batch.body)(batch.n * index / batch.pieces, batch.n * (index + 1) / batch.pieces);
+		} catch (...) {
+			if (!batch.failed.exchange(true)) {
+				batch.error = std::current_exception();
+			}
+		}
+		batch.remaining.fetch_sub(1, std::memory_order_release);
+	}
+	bool StealAndRun(const size_t &home)
+	{
+		for (size_t i = 0; i < SLOTS; ++i) {
+			Slot &slot = slots[(home + i) % SLOTS];
+			slot.visitors.fetch_add(1);
+			Batch *batch = slot.batch.load();
+			size_t index;
+			bool found = batch != nullptr && batch->Steal(index);
+			slot.visitors.fetch_sub(1, std::memory_order_release);
+			if (found) {
+				--queued;
+				Run(*batch, index);
+				return true;
+			}
+		}
+		return false;
+	}
+	void Work(const size_t &index)
+	{
+		Current() = this;
+		while (true) {
+			if (StealAndRun(index)) {
+				continue;
+			}
+			std::unique_lock<std::mutex> guard(sleepLock);
+			wake.wait(guard, [this] { return stopping || queued > 0; });
+			if (stopping && queued == 0) {
+				return;
+			}
+		}
+	}
+public:
+	explicit ThreadPool(const size_t &threads)
+		: n_workers(threads), queued(0)
+	{
+		for (size_t i = 0; i < SLOTS; ++i) {
+			slots[i].batch.store(nullptr, std::memory_order_relaxed);
+			slots[i].visitors.store(0, std::memory_order_relaxed);
+		}
+		workers.reserve(threads);
+		for (size_t i = 0; i < threads; ++i) {
+			workers.push_back(std::thread(&ThreadPool::Work, this, i));
+		}
+	}
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool & operator=(const ThreadPool &) = delete;
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> guard(sleepLock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (size_t i = 0; i < workers.size(); ++i) {
+			workers[i].join();
+		}
+	}
+	inline size_t Size() const
+	{
+		return n_workers;
+	}
+	/**
+	 * Calls body on consecutive pieces of [0, n), each at least grain long,
+	 * and returns once all of them are done; the first exception thrown by
+	 * body is rethrown here. Calls made from inside a task, or while every
+	 * slot is taken by other callers, run inline.
+	 */
+	void ParallelFor(const size_t &n, const size_t &grain, const std::function<void(size_t, size_t)> &body)
+	{
+		size_t pieces = std::min((n + grain - 1) / grain, 4 * (n_workers + 1));
+		if (pieces <= 1 || Current() == this) {
+			body(0, n);
+			return;
+		}
+		Batch batch(&body, n, pieces);
+		Slot *slot = nullptr;
+		for (size_t i = 0; i < SLOTS && slot == nullptr; ++i) {
+			Batch *expected = nullptr;
+			if (slots[i].batch.compare_exchange_strong(expected, &batch)) {
+				slot = &slots[i];
+			}
+		}
+		if (slot == nullptr) {
+			body(0, n);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> guard(sleepLock);
+			queued += pieces;
+		}
+		wake.notify_all();
+		size_t index;
+		while (batch.Pop(index)) {
+			--queued;
+			Run(batch, index);
+		}
+		while (batch.remaining.load(std::memory_order_acquire) != 0) {
+			std::this_thread::yield();
+		}
+		slot->batch.store(nullptr);
+		while (slot->visitors.load(std::memory_order_acquire) != 0) {
+			std::this_thread::yield();
+		}
+		if (batch.error) {
+			std::rethrow_exception(batch.error);
+		}
+	}
+};
+
+/**
+ * The current pool, read and replaced only through std::atomic_load and
+ * std::atomic_store. A running operation keeps its own reference, so
+ * SetThreadCount can swap the pool underneath it.
+ */
+inline std::shared_ptr<ThreadPool> & Pool()
+{
+	static std::shared_ptr<ThreadPool> pool;
+	return pool;
+}
+
+/**
+ * Runs body(begin, end) over [0, n) on the pool, or as one call on this
+ * thread when no pool is set up or n is within one grain.
+ */
+template<typename _Tf>
+void ParallelFor(const size_t &n, const size_t &grain, const _Tf &body)
+{
+	if (n <= grain) {
+		body(size_t(0), n);
+		return;
+	}
+	std::shared_ptr<ThreadPool> pool = std::atomic_load(&Pool());
+	if (pool == nullptr) {
+		body(size_t(0), n);
+		return;
+	}
+	pool->ParallelFor(n, grain, std::function<void(size_t, size_t)>(std::cref(body)));
+}
+
+/**
+ * Rows per piece for element-wise work on rows of cols elements.
+ */
+inline size_t RowGrain(const size_t &cols)
+{
+	return (1 << 15) / std::max(cols, size_t(1)) + 1;
+}
+
+}
+
+/**
+ * Number of threads Matrix products, element-wise operations and == may
+ * use, the calling thread included. 1, the default, keeps everything on the
+ * calling thread; 0 picks std::thread::hardware_concurrency(). Work is split
+ * so that every output element is computed by one thread in the same order
+ * as with one thread, so floating-point results do not depend on the count.
+ * Operations already running on other threads finish on the old pool, which
+ * is shut down once the last of them returns.
+ */
+inline void SetThreadCount(size_t count)
+{
+	if (count == 0) {
+		count = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	std::shared_ptr<detail::ThreadPool> pool;
+	if (count > 1) {
+		pool = std::make_shared<detail::ThreadPool>(count - 1);
+	}
+	std::atomic_store(&detail::Pool(), pool);
+}
+
+inline size_t ThreadCount()
+{
+	std::shared_ptr<detail::ThreadPool> pool = std::atomic_load(&detail::Pool());
+	return pool ? pool->Size() + 1 : 1;
+}
+
+template<typename _Td>
+class Matrix;
+
+/**
+ * Base of Matrix and of the lazy element-wise nodes built by +, -, negation
+ * and scalar * and /. A chain of them runs as one loop, when it is assigned
+ * to or used to construct a Matrix, with no intermediate matrices.
+ */
+template<typename _Te>
+class MatrixExpression {
+public:
+	const _Te & self() const
+	{
+		return static_cast<const _Te &>(*this);
+	}
+};
+
+/**
+ * Non-owning window into a Matrix: element (i, j) is
+ * data()[i * RowStride() + j * ColStride()]. Stays valid as long as the
+ * matrix it was taken from is not resized or destroyed.
+ */
+template<typename _Td>
+class MatrixView {
+protected:
+	_Td *first = nullptr;
+	size_t n_rows = 0;
+	size_t n_cols = 0;
+	size_t rowStride = 0;
+	size_t colStride = 1;
+	class RowProxy {
+		_Td *row;
+		size_t stride;
+	public:
+		RowProxy(_Td *_row, const size_t &_stride) : row(_row), stride(_stride) {}
+		_Td & operator[](const size_t &pos) const
+		{
+			return row[pos * stride];
+		}
+	};
+public:
+	MatrixView() {};
+	MatrixView(_Td *_first, const size_t &_n_rows, const size_t &_n_cols, const size_t &_rowStride, const size_t &_colStride)
+		: first(_first), n_rows(_n_rows), n_cols(_n_cols), rowStride(_rowStride), colStride(_colStride) {}
+	template<typename _Tu>
+	MatrixView(const MatrixView<_Tu> &view)
+		: first(view.data()), n_rows(view.RowSize()), n_cols(view.ColSize()), rowStride(view.RowStride()), colStride(view.ColStride()) {}
+	inline const size_t & RowSize() const
+	{
+		return n_rows;
+	}
+	inline const size_t & ColSize() const
+	{
+		return n_cols;
+	}
+	inline const size_t & RowStride() const
+	{
+		return rowStride;
+	}
+	inline const size_t & ColStride() const
+	{
+		return colStride;
+	}
+	_Td * data() const
+	{
+		return first;
+	}
+	RowProxy operator[](const size_t &Kth) const
+	{
+		return RowProxy(first + Kth * rowStride, colStride);
+	}
+};
+
+/**
+ * Dense matrix in one row-major buffer; row i starts at data() + i * ColSize().
+ */
 template<typename _Td>
-class Matrix {
+class Matrix : public MatrixExpression<Matrix<_Td>> {
 protected:
 	size_t n_rows = 0;
 	size_t n_cols = 0;
-	std::vector<std::vector<_Td>> data;
+	std::vector<_Td> elements;
 	class RowProxy {
-		std::vector<_Td> &row;
+		_Td *row;
 	public:
-		RowProxy(std::vector<_Td> & _row) : row(_row) {}
-		_Td & operator[](const size_t &pos)
+		RowProxy(_Td *_row) : row(_row) {}
+		_Td & operator[](const size_t &pos) const
 		{
 			return row[pos];
 		}
 	};
 	class ConstRowProxy {
-		const std::vector<_Td> &row;
+		const _Td *row;
 	public:
-		ConstRowProxy(const std::vector<_Td> &_row) : row(_row) {}
+		ConstRowProxy(const _Td *_row) : row(_row) {}
 		const _Td & operator[](const size_t &pos) const
 		{
 			return row[pos];
 		}
 	};
+	void CopyFrom(const MatrixView<const _Td> &view)
+	{
+		for (size_t i = 0; i < n_rows; ++i) {
+			const _Td *source = view.data() + i * view.RowStride();
+			_Td *target = elements.data() + i * n_cols;
+			if (view.ColStride() == 1) {
+				std::copy(source, source + n_cols, target);
+				continue;
+			}
+			for (size_t j = 0; j < n_cols; ++j) {
+				target[j] = source[j * view.ColStride()];
+			}
+		}
+	}
+	template<typename _Te>
+	void Fill(const _Te &expr)
+	{
+		_Td *z = elements.data();
+		const size_t cols = n_cols;
+		detail::ParallelFor(n_rows, detail::RowGrain(cols), [z, &expr, cols](size_t begin, size_t end) {
+			for (size_t i = begin * cols, last = end * cols; i < last; ++i) {
+				z[i] = expr.Element(i);
+			}
+		});
+	}
+	void CheckBlock(const size_t &row, const size_t &col, const size_t &rows, const size_t &cols) const
+	{
+		if (row > n_rows || rows > n_rows - row || col > n_cols || cols > n_cols - col) {
+			throw std::out_of_range("block out of the matrix");
+		}
+	}
 public:
+	typedef _Td value_type;
 	Matrix() {};
 	Matrix(const size_t &_n_rows, const size_t &_n_cols)
-		: n_rows(_n_rows), n_cols(_n_cols), data(std::vector<std::vector<_Td>>(n_rows, std::vector<_Td>(n_cols))) {}
+		: n_rows(_n_rows), n_cols(_n_cols), elements(n_rows * n_cols) {}
 	Matrix(const size_t &_n_rows, const size_t &_n_cols, const _Td &fillValue)
-		: n_rows(_n_rows), n_cols(_n_cols), data(std::vector<std::vector<_Td>>(n_rows, std::vector<_Td>(n_cols, fillValue))) {}
+		: n_rows(_n_rows), n_cols(_n_cols), elements(n_rows * n_cols, fillValue) {}
 	Matrix(const Matrix<_Td> &mat)
-		: n_rows(mat.n_rows), n_cols(mat.n_cols), data(mat.data) {}
+		: n_rows(mat.n_rows), n_cols(mat.n_cols), elements(mat.elements) {}
 	Matrix(Matrix<_Td> &&mat) noexcept
-		: n_rows(mat.n_rows), n_cols(mat.n_cols), data(mat.data) {}
+		: n_rows(mat.n_rows), n_cols(mat.n_cols), elements(std::move(mat.elements))
+	{
+		mat.n_rows = mat.n_cols = 0;
+	}
+	template<typename _Te>
+	Matrix(const MatrixExpression<_Te> &expr)
+		: n_rows(expr.self().RowSize()), n_cols(expr.self().ColSize()), elements(n_rows * n_cols)
+	{
+		Fill(expr.self());
+	}
+	/**
+	 * Copy of a view's elements.
+	 */
+	explicit Matrix(const MatrixView<_Td> &view)
+		: n_rows(view.RowSize()), n_cols(view.ColSize()), elements(n_rows * n_cols)
+	{
+		CopyFrom(view);
+	}
+	explicit Matrix(const MatrixView<const _Td> &view)
+		: n_rows(view.RowSize()), n_cols(view.ColSize()), elements(n_rows * n_cols)
+	{
+		CopyFrom(view);
+	}
 	Matrix<_Td> & operator=(const Matrix<_Td> &rhs)
 	{
 		this->n_rows = rhs.n_rows;
 		this->n_cols = rhs.n_cols;
-		this->data = rhs.data;
+		this->elements = rhs.elements;
 		return *this;
 	}
-	Matrix<_Td> & operator=(Matrix<_Td> &&rhs)
+	Matrix<_Td> & operator=(Matrix<_Td> &&rhs) noexcept
 	{
+		if (this == &rhs) {
+			return *this;
+		}
 		this->n_rows = rhs.n_rows;
 		this->n_cols = rhs.n_cols;
-		this->data = rhs.data;
+		this->elements = std::move(rhs.elements);
+		rhs.n_rows = rhs.n_cols = 0;
+		return *this;
+	}
+	/**
+	 * Evaluates in place when the size already matches; the expression may
+	 * read this matrix, since each element only depends on the same
+	 * position of its operands.
+	 */
+	template<typename _Te>
+	Matrix<_Td> & operator=(const MatrixExpression<_Te> &expr)
+	{
+		const _Te &e = expr.self();
+		if (e.RowSize() != n_rows || e.ColSize() != n_cols) {
+			size_t rows = e.RowSize(), cols = e.ColSize();
+			elements.resize(rows * cols);
+			n_rows = rows;
+			n_cols = cols;
+		}
+		Fill(e);
 		return *this;
 	}
 	inline const size_t & RowSize() const
@@ -64,158 +506,711 @@ public:
 	{
 		return n_cols;
 	}
+	const _Td & Element(const size_t &k) const
+	{
+		return elements[k];
+	}
+	_Td * data()
+	{
+		return elements.data();
+	}
+	const _Td * data() const
+	{
+		return elements.data();
+	}
 	RowProxy operator[](const size_t &Kth)
 	{
-		return RowProxy(this->data[Kth]);
+		return RowProxy(this->elements.data() + Kth * n_cols);
 	}
 	const ConstRowProxy operator[](const size_t &Kth) const
 	{
-		return ConstRowProxy(this->data[Kth]);
+		return ConstRowProxy(this->elements.data() + Kth * n_cols);
+	}
+	/**
+	 * Views of one row, one column or a rows x cols block starting at
+	 * (row, col); they share the matrix's elements.
+	 */
+	MatrixView<_Td> Row(const size_t &Kth)
+	{
+		return SubMatrix(Kth, 0, 1, n_cols);
+	}
+	MatrixView<const _Td> Row(const size_t &Kth) const
+	{
+		return SubMatrix(Kth, 0, 1, n_cols);
+	}
+	MatrixView<_Td> Col(const size_t &Kth)
+	{
+		return SubMatrix(0, Kth, n_rows, 1);
+	}
+	MatrixView<const _Td> Col(const size_t &Kth) const
+	{
+		return SubMatrix(0, Kth, n_rows, 1);
+	}
+	MatrixView<_Td> SubMatrix(const size_t &row, const size_t &col, const size_t &rows, const size_t &cols)
+	{
+		CheckBlock(row, col, rows, cols);
+		return MatrixView<_Td>(elements.data() + row * n_cols + col, rows, cols, n_cols, 1);
+	}
+	MatrixView<const _Td> SubMatrix(const size_t &row, const size_t &col, const size_t &rows, const size_t &cols) const
+	{
+		CheckBlock(row, col, rows, cols);
+		return MatrixView<const _Td>(elements.data() + row * n_cols + col, rows, cols, n_cols, 1);
 	}
 	~Matrix() = default;
 };
 
+namespace detail {
+
 /**
- * Sum of two matrics.
+ * How a node stores an operand: named matrices by reference, temporaries
+ * and other nodes by value, so an expression never outlives a temporary it
+ * reads.
  */
+template<typename _Te>
+struct ExpressionOperand {
+	typedef typename std::decay<_Te>::type type;
+};
+
 template<typename _Td>
-Matrix<_Td> operator+(const Matrix<_Td> &a, const Matrix<_Td> &b)
-{
-	if (a.RowSize() != b.RowSize() || a.ColSize() != b.ColSize()) {
-		throw std::invalid_argument("different matrics\'s sizes");
+struct ExpressionOperand<Matrix<_Td> &> {
+	typedef const Matrix<_Td> & type;
+};
+
+template<typename _Td>
+struct ExpressionOperand<const Matrix<_Td> &> {
+	typedef const Matrix<_Td> & type;
+};
+
+template<typename _Te>
+struct IsExpression : std::is_base_of<MatrixExpression<typename std::decay<_Te>::type>, typename std::decay<_Te>::type> {};
+
+template<typename _Tl, typename _Tr>
+struct AreExpressions : std::integral_constant<bool, IsExpression<_Tl>::value && IsExpression<_Tr>::value> {};
+
+struct Plus {
+	template<typename _Ta, typename _Tb>
+	static auto Apply(const _Ta &a, const _Tb &b) -> decltype(a + b)
+	{
+		return a + b;
 	}
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] + b[i][j];
-		}
+};
+
+struct Minus {
+	template<typename _Ta, typename _Tb>
+	static auto Apply(const _Ta &a, const _Tb &b) -> decltype(a - b)
+	{
+		return a - b;
 	}
-	return c;
-}
+};
+
+struct Times {
+	template<typename _Ta, typename _Tb>
+	static auto Apply(const _Ta &a, const _Tb &b) -> decltype(a * b)
+	{
+		return a * b;
+	}
+};
+
+struct Divide {
+	template<typename _Ta, typename _Tb>
+	static auto Apply(const _Ta &a, const _Tb &b) -> decltype(a / b)
+	{
+		return a / b;
+	}
+};
 
 template<typename _Td>
-Matrix<_Td> operator-(const Matrix<_Td> &a, const Matrix<_Td> &b)
+const Matrix<_Td> & Evaluate(const Matrix<_Td> &mat)
 {
-	if (a.RowSize() != b.RowSize() || a.ColSize() != b.ColSize()) {
-		throw std::invalid_argument("different matrics\'s sizes");
-	}
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] - b[i][j];
+	return mat;
+}
+
+template<typename _Te>
+Matrix<typename _Te::value_type> Evaluate(const MatrixExpression<_Te> &expr)
+{
+	return Matrix<typename _Te::value_type>(expr);
+}
+
+}
+
+/**
+ * Element-wise a op b of two same-sized expressions.
+ */
+template<typename _Tl, typename _Tr, typename _Op>
+class MatrixBinary : public MatrixExpression<MatrixBinary<_Tl, _Tr, _Op>> {
+	typename detail::ExpressionOperand<_Tl>::type lhs;
+	typename detail::ExpressionOperand<_Tr>::type rhs;
+public:
+	typedef typename std::decay<_Tl>::type::value_type value_type;
+	static_assert(std::is_same<value_type, typename std::decay<_Tr>::type::value_type>::value, "different matrics\'s element types");
+	MatrixBinary(_Tl &&_lhs, _Tr &&_rhs)
+		: lhs(std::forward<_Tl>(_lhs)), rhs(std::forward<_Tr>(_rhs))
+	{
+		if (lhs.RowSize() != rhs.RowSize() || lhs.ColSize() != rhs.ColSize()) {
+			throw std::invalid_argument("different matrics\'s sizes");
 		}
 	}
-	return c;
+	inline const size_t & RowSize() const
+	{
+		return lhs.RowSize();
+	}
+	inline const size_t & ColSize() const
+	{
+		return lhs.ColSize();
+	}
+	value_type Element(const size_t &k) const
+	{
+		return _Op::Apply(lhs.Element(k), rhs.Element(k));
+	}
+};
+
+/**
+ * Element-wise a op s for an expression a and a number s.
+ */
+template<typename _Te, typename _Ts, typename _Op>
+class MatrixScalar : public MatrixExpression<MatrixScalar<_Te, _Ts, _Op>> {
+	typename detail::ExpressionOperand<_Te>::type expr;
+	_Ts scalar;
+public:
+	typedef typename std::decay<_Te>::type::value_type value_type;
+	MatrixScalar(_Te &&_expr, const _Ts &_scalar)
+		: expr(std::forward<_Te>(_expr)), scalar(_scalar) {}
+	inline const size_t & RowSize() const
+	{
+		return expr.RowSize();
+	}
+	inline const size_t & ColSize() const
+	{
+		return expr.ColSize();
+	}
+	value_type Element(const size_t &k) const
+	{
+		return _Op::Apply(expr.Element(k), scalar);
+	}
+};
+
+template<typename _Te>
+class MatrixNegate : public MatrixExpression<MatrixNegate<_Te>> {
+	typename detail::ExpressionOperand<_Te>::type expr;
+public:
+	typedef typename std::decay<_Te>::type::value_type value_type;
+	MatrixNegate(_Te &&_expr)
+		: expr(std::forward<_Te>(_expr)) {}
+	inline const size_t & RowSize() const
+	{
+		return expr.RowSize();
+	}
+	inline const size_t & ColSize() const
+	{
+		return expr.ColSize();
+	}
+	value_type Element(const size_t &k) const
+	{
+		return -expr.Element(k);
+	}
+};
+
+/**
+ * Sum of two matrics.
+ */
+template<typename _Tl, typename _Tr>
+typename std::enable_if<detail::AreExpressions<_Tl, _Tr>::value, MatrixBinary<_Tl, _Tr, detail::Plus>>::type
+operator+(_Tl &&a, _Tr &&b)
+{
+	return MatrixBinary<_Tl, _Tr, detail::Plus>(std::forward<_Tl>(a), std::forward<_Tr>(b));
 }
-template<typename _Td>
-bool operator==(const Matrix<_Td> &a, const Matrix<_Td> &b)
+
+template<typename _Tl, typename _Tr>
+typename std::enable_if<detail::AreExpressions<_Tl, _Tr>::value, MatrixBinary<_Tl, _Tr, detail::Minus>>::type
+operator-(_Tl &&a, _Tr &&b)
+{
+	return MatrixBinary<_Tl, _Tr, detail::Minus>(std::forward<_Tl>(a), std::forward<_Tr>(b));
+}
+
+template<typename _Tl, typename _Tr>
+typename std::enable_if<detail::AreExpressions<_Tl, _Tr>::value, bool>::type
+operator==(const _Tl &a, const _Tr &b)
 {
 	if (a.RowSize() != b.RowSize() || a.ColSize() != b.ColSize()) {
 		return false;
 	}
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			if (a[i][j] != b[i][j])
-				return false;
+	const size_t cols = a.ColSize();
+	std::atomic<bool> equal(true);
+	detail::ParallelFor(a.RowSize(), detail::RowGrain(cols), [&a, &b, &equal, cols](size_t begin, size_t end) {
+		for (size_t r = begin; r < end && equal.load(std::memory_order_relaxed); ++r) {
+			for (size_t i = r * cols, last = i + cols; i < last; ++i) {
+				if (a.Element(i) != b.Element(i)) {
+					equal.store(false, std::memory_order_relaxed);
+					return;
+				}
+			}
 		}
-	}
-	return true;
+	});
+	return equal.load();
 }
 
+template<typename _Te>
+typename std::enable_if<detail::IsExpression<_Te>::value, MatrixNegate<_Te>>::type
+operator-(_Te &&mat)
+{
+	return MatrixNegate<_Te>(std::forward<_Te>(mat));
+}
+
+/**
+ * A temporary matrix is negated in place.
+ */
 template<typename _Td>
-Matrix<_Td> operator-(const Matrix<_Td> &mat)
+Matrix<_Td> operator-(Matrix<_Td> &&mat)
 {
-	Matrix<_Td> result(mat.RowSize(), mat.ColSize());
-	for (size_t i = 0; i < mat.RowSize(); ++i) {
-		for (size_t j = 0; j < mat.ColSize(); ++j) {
-			result[i][j] = -mat[i][j];
+	_Td *x = mat.data();
+	const size_t cols = mat.ColSize();
+	detail::ParallelFor(mat.RowSize(), detail::RowGrain(cols), [x, cols](size_t begin, size_t end) {
+		for (size_t i = begin * cols, last = end * cols; i < last; ++i) {
+			x[i] = -x[i];
 		}
-	}
-	return result;
+	});
+	return std::move(mat);
 }
 
+namespace detail {
+
+/**
+ * Blocking for the packed product: a GEMM_KC x GEMM_NC panel of b stays in
+ * L3, a GEMM_MC x GEMM_KC block of a in L2, and the micro-kernel keeps an
+ * mr x nr tile of the result in registers. Below GEMM_MIN_WORK
+ * multiply-adds packing costs more than it saves. Products are only shared
+ * out to the thread pool from GEMM_PARALLEL_WORK multiply-adds up, in output
+ * tiles of GEMM_MC x GEMM_TILE_N.
+ */
+const size_t GEMM_MC = 96;
+const size_t GEMM_KC = 256;
+const size_t GEMM_NC = 2048;
+const size_t GEMM_MIN_WORK = 32 * 32 * 32;
+const size_t GEMM_PARALLEL_WORK = 64 * 64 * 64;
+const size_t GEMM_TILE_N = 256;
+
+/**
+ * Adds the mr x nr tile a * b to the rows c[0..mr), where a is a packed panel
+ * of kc steps of mr values and b one of kc steps of nr values.
+ */
 template<typename _Td>
-Matrix<_Td> operator-(Matrix<_Td> &&mat)
+struct GemmKernel {
+	size_t mr, nr;
+	void (*run)(size_t kc, const _Td *a, const _Td *b, _Td *const *c);
+};
+
+template<typename _Td, size_t MR, size_t NR>
+void gemmKernelScalar(size_t kc, const _Td *a, const _Td *b, _Td *const *c)
 {
-	for (size_t i = 0; i < mat.RowSize(); ++i) {
-		for (size_t j = 0; j < mat.ColSize(); ++j) {
-			mat[i][j] = -mat[i][j];
+	_Td tile[MR][NR] = {};
+	for (size_t p = 0; p < kc; ++p, a += MR, b += NR) {
+		for (size_t r = 0; r < MR; ++r) {
+			for (size_t j = 0; j < NR; ++j) {
+				tile[r][j] += a[r] * b[j];
+			}
 		}
 	}
-	return mat;
+	for (size_t r = 0; r < MR; ++r) {
+		for (size_t j = 0; j < NR; ++j) {
+			c[r][j] += tile[r][j];
+		}
+	}
+}
+
+#ifdef DIAMOND_MATRIX_SIMD
+__attribute__((target("avx2,fma")))
+inline void gemmKernelAvx2(size_t kc, const double *a, const double *b, double *const *c)
+{
+	__m256d c00 = _mm256_setzero_pd(), c01 = c00, c10 = c00, c11 = c00, c20 = c00, c21 = c00;
+	__m256d c30 = c00, c31 = c00, c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+	for (size_t p = 0; p < kc; ++p, a += 6, b += 8) {
+		__m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4), x;
+		x = _mm256_broadcast_sd(a);
+		c00 = _mm256_fmadd_pd(x, b0, c00);
+		c01 = _mm256_fmadd_pd(x, b1, c01);
+		x = _mm256_broadcast_sd(a + 1);
+		c10 = _mm256_fmadd_pd(x, b0, c10);
+		c11 = _mm256_fmadd_pd(x, b1, c11);
+		x = _mm256_broadcast_sd(a + 2);
+		c20 = _mm256_fmadd_pd(x, b0, c20);
+		c21 = _mm256_fmadd_pd(x, b1, c21);
+		x = _mm256_broadcast_sd(a + 3);
+		c30 = _mm256_fmadd_pd(x, b0, c30);
+		c31 = _mm256_fmadd_pd(x, b1, c31);
+		x = _mm256_broadcast_sd(a + 4);
+		c40 = _mm256_fmadd_pd(x, b0, c40);
+		c41 = _mm256_fmadd_pd(x, b1, c41);
+		x = _mm256_broadcast_sd(a + 5);
+		c50 = _mm256_fmadd_pd(x, b0, c50);
+		c51 = _mm256_fmadd_pd(x, b1, c51);
+	}
+	__m256d tile[6][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+	for (size_t r = 0; r < 6; ++r) {
+		_mm256_storeu_pd(c[r], _mm256_add_pd(_mm256_loadu_pd(c[r]), tile[r][0]));
+		_mm256_storeu_pd(c[r] + 4, _mm256_add_pd(_mm256_loadu_pd(c[r] + 4), tile[r][1]));
+	}
+}
+
+__attribute__((target("avx2,fma")))
+inline void gemmKernelAvx2(size_t kc, const float *a, const float *b, float *const *c)
+{
+	__m256 c00 = _mm256_setzero_ps(), c01 = c00, c10 = c00, c11 = c00, c20 = c00, c21 = c00;
+	__m256 c30 = c00, c31 = c00, c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+	for (size_t p = 0; p < kc; ++p, a += 6, b += 16) {
+		__m256 b0 = _mm256_loadu_ps(b), b1 = _mm256_loadu_ps(b + 8), x;
+		x = _mm256_broadcast_ss(a);
+		c00 = _mm256_fmadd_ps(x, b0, c00);
+		c01 = _mm256_fmadd_ps(x, b1, c01);
+		x = _mm256_broadcast_ss(a + 1);
+		c10 = _mm256_fmadd_ps(x, b0, c10);
+		c11 = _mm256_fmadd_ps(x, b1, c11);
+		x = _mm256_broadcast_ss(a + 2);
+		c20 = _mm256_fmadd_ps(x, b0, c20);
+		c21 = _mm256_fmadd_ps(x, b1, c21);
+		x = _mm256_broadcast_ss(a + 3);
+		c30 = _mm256_fmadd_ps(x, b0, c30);
+		c31 = _mm256_fmadd_ps(x, b1, c31);
+		x = _mm256_broadcast_ss(a + 4);
+		c40 = _mm256_fmadd_ps(x, b0, c40);
+		c41 = _mm256_fmadd_ps(x, b1, c41);
+		x = _mm256_broadcast_ss(a + 5);
+		c50 = _mm256_fmadd_ps(x, b0, c50);
+		c51 = _mm256_fmadd_ps(x, b1, c51);
+	}
+	__m256 tile[6][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+	for (size_t r = 0; r < 6; ++r) {
+		_mm256_storeu_ps(c[r], _mm256_add_ps(_mm256_loadu_ps(c[r]), tile[r][0]));
+		_mm256_storeu_ps(c[r] + 8, _mm256_add_ps(_mm256_loadu_ps(c[r] + 8), tile[r][1]));
+	}
+}
+
+__attribute__((target("avx512f")))
+inline void gemmKernelAvx512(size_t kc, const double *a, const double *b, double *const *c)
+{
+	__m512d c00 = _mm512_setzero_pd(), c01 = c00, c10 = c00, c11 = c00, c20 = c00, c21 = c00;
+	__m512d c30 = c00, c31 = c00, c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+	for (size_t p = 0; p < kc; ++p, a += 6, b += 16) {
+		__m512d b0 = _mm512_loadu_pd(b), b1 = _mm512_loadu_pd(b + 8), x;
+		x = _mm512_set1_pd(a[0]);
+		c00 = _mm512_fmadd_pd(x, b0, c00);
+		c01 = _mm512_fmadd_pd(x, b1, c01);
+		x = _mm512_set1_pd(a[1]);
+		c10 = _mm512_fmadd_pd(x, b0, c10);
+		c11 = _mm512_fmadd_pd(x, b1, c11);
+		x = _mm512_set1_pd(a[2]);
+		c20 = _mm512_fmadd_pd(x, b0, c20);
+		c21 = _mm512_fmadd_pd(x, b1, c21);
+		x = _mm512_set1_pd(a[3]);
+		c30 = _mm512_fmadd_pd(x, b0, c30);
+		c31 = _mm512_fmadd_pd(x, b1, c31);
+		x = _mm512_set1_pd(a[4]);
+		c40 = _mm512_fmadd_pd(x, b0, c40);
+		c41 = _mm512_fmadd_pd(x, b1, c41);
+		x = _mm512_set1_pd(a[5]);
+		c50 = _mm512_fmadd_pd(x, b0, c50);
+		c51 = _mm512_fmadd_pd(x, b1, c51);
+	}
+	__m512d tile[6][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+	for (size_t r = 0; r < 6; ++r) {
+		_mm512_storeu_pd(c[r], _mm512_add_pd(_mm512_loadu_pd(c[r]), tile[r][0]));
+		_mm512_storeu_pd(c[r] + 8, _mm512_add_pd(_mm512_loadu_pd(c[r] + 8), tile[r][1]));
+	}
+}
+
+__attribute__((target("avx512f")))
+inline void gemmKernelAvx512(size_t kc, const float *a, const float *b, float *const *c)
+{
+	__m512 c00 = _mm512_setzero_ps(), c01 = c00, c10 = c00, c11 = c00, c20 = c00, c21 = c00;
+	__m512 c30 = c00, c31 = c00, c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+	for (size_t p = 0; p < kc; ++p, a += 6, b += 32) {
+		__m512 b0 = _mm512_loadu_ps(b), b1 = _mm512_loadu_ps(b + 16), x;
+		x = _mm512_set1_ps(a[0]);
+		c00 = _mm512_fmadd_ps(x, b0, c00);
+		c01 = _mm512_fmadd_ps(x, b1, c01);
+		x = _mm512_set1_ps(a[1]);
+		c10 = _mm512_fmadd_ps(x, b0, c10);
+		c11 = _mm512_fmadd_ps(x, b1, c11);
+		x = _mm512_set1_ps(a[2]);
+		c20 = _mm512_fmadd_ps(x, b0, c20);
+		c21 = _mm512_fmadd_ps(x, b1, c21);
+		x = _mm512_set1_ps(a[3]);
+		c30 = _mm512_fmadd_ps(x, b0, c30);
+		c31 = _mm512_fmadd_ps(x, b1, c31);
+		x = _mm512_set1_ps(a[4]);
+		c40 = _mm512_fmadd_ps(x, b0, c40);
+		c41 = _mm512_fmadd_ps(x, b1, c41);
+		x = _mm512_set1_ps(a[5]);
+		c50 = _mm512_fmadd_ps(x, b0, c50);
+		c51 = _mm512_fmadd_ps(x, b1, c51);
+	}
+	__m512 tile[6][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+	for (size_t r = 0; r < 6; ++r) {
+		_mm512_storeu_ps(c[r], _mm512_add_ps(_mm512_loadu_ps(c[r]), tile[r][0]));
+		_mm512_storeu_ps(c[r] + 16, _mm512_add_ps(_mm512_loadu_ps(c[r] + 16), tile[r][1]));
+	}
 }
+#endif
 
 /**
- * Multiplication of two matrics.
+ * The widest kernel the CPU supports, or NULL for element types that take
+ * the generic path.
  */
 template<typename _Td>
-Matrix<_Td> operator*(const Matrix<_Td> &a, const Matrix<_Td> &b)
+inline const GemmKernel<_Td> *gemmKernel()
 {
-	if (a.ColSize() != b.RowSize()) {
-		throw std::invalid_argument("different matrics\'s sizes");
+	return NULL;
+}
+
+template<>
+inline const GemmKernel<double> *gemmKernel<double>()
+{
+	static const GemmKernel<double> scalar = {4, 4, gemmKernelScalar<double, 4, 4>};
+#ifdef DIAMOND_MATRIX_SIMD
+	static const GemmKernel<double> avx2 = {6, 8, gemmKernelAvx2}, avx512 = {6, 16, gemmKernelAvx512};
+	static const bool hasAvx512 = __builtin_cpu_supports("avx512f");
+	static const bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	if (hasAvx512) {
+		return &avx512;
+	}
+	if (hasAvx2) {
+		return &avx2;
+	}
+#endif
+	return &scalar;
+}
+
+template<>
+inline const GemmKernel<float> *gemmKernel<float>()
+{
+	static const GemmKernel<float> scalar = {4, 4, gemmKernelScalar<float, 4, 4>};
+#ifdef DIAMOND_MATRIX_SIMD
+	static const GemmKernel<float> avx2 = {6, 16, gemmKernelAvx2}, avx512 = {6, 32, gemmKernelAvx512};
+	static const bool hasAvx512 = __builtin_cpu_supports("avx512f");
+	static const bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	if (hasAvx512) {
+		return &avx512;
+	}
+	if (hasAvx2) {
+		return &avx2;
 	}
-	Matrix<_Td> c(a.RowSize(), b.ColSize(), 0);
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < b.ColSize(); ++j) {
-			for (size_t k = 0; k < a.ColSize(); ++k) {
-				c[i][j] += a[i][k] * b[k][j];
+#endif
+	return &scalar;
+}
+
+/**
+ * Copy rows [i0, i0 + mc) x columns [k0, k0 + kc) of a, whose rows are lda
+ * apart, into panels of mr rows, stored column by column and padded with
+ * zeros.
+ */
+template<typename _Td>
+void gemmPackA(const _Td *a, size_t lda, size_t i0, size_t mc, size_t k0, size_t kc, size_t mr, _Td *out)
+{
+	for (size_t ir = 0; ir < mc; ir += mr) {
+		size_t rows = std::min(mr, mc - ir);
+		for (size_t p = 0; p < kc; ++p) {
+			for (size_t r = 0; r < rows; ++r) {
+				*out++ = a[(i0 + ir + r) * lda + k0 + p];
+			}
+			for (size_t r = rows; r < mr; ++r) {
+				*out++ = _Td(0);
 			}
 		}
 	}
-	return c;
 }
 
 /**
- * Operations between a number and a matrix;
+ * Copy rows [k0, k0 + kc) x columns [j0, j0 + nc) of b, whose rows are ldb
+ * apart, into panels of nr columns, stored row by row and padded with zeros.
  */
 template<typename _Td>
-Matrix<_Td> operator*(const Matrix<_Td> &a, const _Td &b)
+void gemmPackB(const _Td *b, size_t ldb, size_t k0, size_t kc, size_t j0, size_t nc, size_t nr, _Td *out)
 {
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] * b;
+	for (size_t jr = 0; jr < nc; jr += nr) {
+		size_t cols = std::min(nr, nc - jr);
+		for (size_t p = 0; p < kc; ++p) {
+			const _Td *row = b + (k0 + p) * ldb + j0 + jr;
+			for (size_t j = 0; j < cols; ++j) {
+				*out++ = row[j];
+			}
+			for (size_t j = cols; j < nr; ++j) {
+				*out++ = _Td(0);
+			}
 		}
 	}
-	return c;
 }
 
+/**
+ * c += a * b for an m x k matrix a and a k x n matrix b; lda, ldb and ldc
+ * are the distances between consecutive rows. Partial tiles at the right and
+ * bottom edges are computed into a scratch tile and added back.
+ */
 template<typename _Td>
-Matrix<_Td> operator*(const _Td &b, const Matrix<_Td> &a)
+void gemmBlocked(size_t m, size_t n, size_t k, const _Td *a, size_t lda, const _Td *b, size_t ldb, _Td *c, size_t ldc, const GemmKernel<_Td> &kernel)
 {
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] * b;
+	const size_t mr = kernel.mr, nr = kernel.nr;
+	size_t panelK = std::min(GEMM_KC, k);
+	size_t panelM = std::min(GEMM_MC, (m + mr - 1) / mr * mr), panelN = std::min(GEMM_NC, (n + nr - 1) / nr * nr);
+	std::vector<_Td> packedA(panelM * panelK), packedB(panelK * panelN), edge(mr * nr);
+	std::vector<_Td *> rows(mr);
+	for (size_t j0 = 0; j0 < n; j0 += GEMM_NC) {
+		size_t nc = std::min(GEMM_NC, n - j0);
+		for (size_t k0 = 0; k0 < k; k0 += GEMM_KC) {
+			size_t kc = std::min(GEMM_KC, k - k0);
+			gemmPackB(b, ldb, k0, kc, j0, nc, nr, &packedB[0]);
+			for (size_t i0 = 0; i0 < m; i0 += GEMM_MC) {
+				size_t mc = std::min(GEMM_MC, m - i0);
+				gemmPackA(a, lda, i0, mc, k0, kc, mr, &packedA[0]);
+				for (size_t jr = 0; jr < nc; jr += nr) {
+					size_t cols = std::min(nr, nc - jr);
+					for (size_t ir = 0; ir < mc; ir += mr) {
+						size_t height = std::min(mr, mc - ir);
+						_Td *tile = c + (i0 + ir) * ldc + j0 + jr;
+						if (height == mr && cols == nr) {
+							for (size_t r = 0; r < mr; ++r) {
+								rows[r] = tile + r * ldc;
+							}
+							kernel.run(kc, &packedA[ir * kc], &packedB[jr * kc], &rows[0]);
+							continue;
+						}
+						std::fill(edge.begin(), edge.end(), _Td(0));
+						for (size_t r = 0; r < mr; ++r) {
+							rows[r] = &edge[r * nr];
+						}
+						kernel.run(kc, &packedA[ir * kc], &packedB[jr * kc], &rows[0]);
+						for (size_t r = 0; r < height; ++r) {
+							for (size_t j = 0; j < cols; ++j) {
+								tile[r * ldc + j] += edge[r * nr + j];
+							}
+						}
+					}
+				}
+			}
 		}
 	}
-	return c;
 }
 
+/**
+ * c += a * b in i-k-j order, so the inner loop runs along rows of b and c.
+ */
 template<typename _Td>
-Matrix<_Td> operator/(const Matrix<_Td> &a, const double &b)
+void gemmGeneric(size_t m, size_t n, size_t k, const _Td *a, size_t lda, const _Td *b, size_t ldb, _Td *c, size_t ldc)
 {
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] / b;
+	for (size_t i = 0; i < m; ++i) {
+		_Td *row = c + i * ldc;
+		for (size_t p = 0; p < k; ++p) {
+			const _Td &scale = a[i * lda + p];
+			const _Td *other = b + p * ldb;
+			for (size_t j = 0; j < n; ++j) {
+				row[j] += scale * other[j];
+			}
 		}
 	}
+}
+
+}
+
+/**
+ * Multiplication of two matrics. float and double go through a packed,
+ * cache-blocked kernel (AVX2 or AVX-512 where the CPU has it); other types
+ * use a plain i-k-j loop. With more than one thread (see SetThreadCount) the
+ * output is cut into GEMM_MC x GEMM_TILE_N tiles, or into row ranges for the
+ * plain loop, and each piece is computed whole by one thread, so the result
+ * does not depend on the thread count.
+ */
+template<typename _Td>
+Matrix<_Td> operator*(const Matrix<_Td> &a, const Matrix<_Td> &b)
+{
+	if (a.ColSize() != b.RowSize()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	const size_t m = a.RowSize(), n = b.ColSize(), k = a.ColSize();
+	Matrix<_Td> c(m, n, 0);
+	if (m == 0 || n == 0 || k == 0) {
+		return c;
+	}
+	const _Td *x = a.data(), *y = b.data();
+	_Td *z = c.data();
+	const detail::GemmKernel<_Td> *kernel = detail::gemmKernel<_Td>();
+	if (kernel == NULL || m * n * k < detail::GEMM_MIN_WORK) {
+		detail::ParallelFor(m, detail::GEMM_PARALLEL_WORK / (n * k) + 1, [=](size_t begin, size_t end) {
+			detail::gemmGeneric(end - begin, n, k, x + begin * k, k, y, n, z + begin * n, n);
+		});
+		return c;
+	}
+	if (ThreadCount() == 1 || m * n * k < detail::GEMM_PARALLEL_WORK) {
+		detail::gemmBlocked(m, n, k, x, k, y, n, z, n, *kernel);
+		return c;
+	}
+	const size_t tileRows = (m + detail::GEMM_MC - 1) / detail::GEMM_MC, tileCols = (n + detail::GEMM_TILE_N - 1) / detail::GEMM_TILE_N;
+	detail::ParallelFor(tileRows * tileCols, 1, [=](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; ++t) {
+			size_t i0 = t / tileCols * detail::GEMM_MC, j0 = t % tileCols * detail::GEMM_TILE_N;
+			size_t mc = std::min(detail::GEMM_MC, m - i0), nc = std::min(detail::GEMM_TILE_N, n - j0);
+			detail::gemmBlocked(mc, nc, k, x + i0 * k, k, y + j0, n, z + i0 * n + j0, n, *kernel);
+		}
+	});
 	return c;
 }
 
+/**
+ * Products with an unevaluated operand evaluate it first.
+ */
+template<typename _Tl, typename _Tr>
+typename std::enable_if<detail::AreExpressions<_Tl, _Tr>::value, Matrix<typename _Tl::value_type>>::type
+operator*(const _Tl &a, const _Tr &b)
+{
+	return detail::Evaluate(a) * detail::Evaluate(b);
+}
+
+/**
+ * Operations between a number and a matrix;
+ */
+template<typename _Te>
+typename std::enable_if<detail::IsExpression<_Te>::value, MatrixScalar<_Te, typename std::decay<_Te>::type::value_type, detail::Times>>::type
+operator*(_Te &&a, const typename std::decay<_Te>::type::value_type &b)
+{
+	return MatrixScalar<_Te, typename std::decay<_Te>::type::value_type, detail::Times>(std::forward<_Te>(a), b);
+}
+
+template<typename _Te>
+typename std::enable_if<detail::IsExpression<_Te>::value, MatrixScalar<_Te, typename std::decay<_Te>::type::value_type, detail::Times>>::type
+operator*(const typename std::decay<_Te>::type::value_type &b, _Te &&a)
+{
+	return MatrixScalar<_Te, typename std::decay<_Te>::type::value_type, detail::Times>(std::forward<_Te>(a), b);
+}
+
+template<typename _Te>
+typename std::enable_if<detail::IsExpression<_Te>::value, MatrixScalar<_Te, double, detail::Divide>>::type
+operator/(_Te &&a, const double &b)
+{
+	return MatrixScalar<_Te, double, detail::Divide>(std::forward<_Te>(a), b);
+}
+
 template<typename _Td>
 Matrix<_Td> Transpose(const Matrix<_Td> &a)
 {
-	Matrix<_Td> res(a.ColSize(), a.RowSize());
-	for (size_t i = 0; i < a.ColSize(); ++i) {
-		for (size_t j = 0; j < a.RowSize(); ++j) {
-			res[i][j] = a[j][i];
+	const size_t m = a.RowSize(), n = a.ColSize(), tile = 8;
+	Matrix<_Td> res(n, m);
+	const _Td *x = a.data();
+	_Td *z = res.data();
+	for (size_t i0 = 0; i0 < m; i0 += tile) {
+		for (size_t j0 = 0; j0 < n; j0 += tile) {
+			for (size_t i = i0; i < std::min(m, i0 + tile); ++i) {
+				for (size_t j = j0; j < std::min(n, j0 + tile); ++j) {
+					z[j * m + i] = x[i * n + j];
+				}
+			}
 		}
 	}
 	return res;
 }
 
+template<typename _Te>
+Matrix<typename _Te::value_type> Transpose(const MatrixExpression<_Te> &a)
+{
+	return Transpose(detail::Evaluate(a.self()));
+}
+
 template<typename _Td>
 std::ostream & operator<<(std::ostream &stream, const Matrix<_Td> &mat)
 {
@@ -235,6 +1230,12 @@ std::ostream & operator<<(std::ostream &stream, const Matrix<_Td> &mat)
 	return stream;
 }
 
+template<typename _Te>
+std::ostream & operator<<(std::ostream &stream, const MatrixExpression<_Te> &expr)
+{
+	return stream << detail::Evaluate(expr.self());
+}
+
 template<typename _Td>
 Matrix<_Td> I(const size_t &n)
 {
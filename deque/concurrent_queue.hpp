@@ -0,0 +1,194 @@
+#ifndef SJTU_CONCURRENT_QUEUE_HPP
+#define SJTU_CONCURRENT_QUEUE_HPP
+
+#include "exceptions.hpp"
+
+#include <cstddef>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace sjtu {
+
+	const size_t cacheLineSize = 64;
+
+	inline size_t ceilPowerOfTwo(size_t n) {
+		size_t result = 1;
+		while (result < n) result <<= 1;
+		return result;
+	}
+
+	/**
+	 * Bounded lock-free queue for exactly one producer thread and one consumer thread.
+	 * Each side caches the other side's index and reloads it only when the queue
+	 * looks full (or empty), so the two shared indices rarely move between cores.
+	 */
+	template<class T>
+	class spsc_queue {
+	private:
+		typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type slot;
+		slot *slots;
+		size_t mask;
+		char padding0[cacheLineSize];
+		std::atomic<size_t> tailIndex;
+		size_t headCache;
+		char padding1[cacheLineSize];
+		std::atomic<size_t> headIndex;
+		size_t tailCache;
+		char padding2[cacheLineSize];
+	public:
+		explicit spsc_queue(size_t capacity) : tailIndex(0), headCache(0), headIndex(0), tailCache(0) {
+			if (capacity == 0) throw runtime_error();
+			capacity = ceilPowerOfTwo(capacity);
+			mask = capacity - 1;
+			slots = new slot[capacity];
+		}
+		spsc_queue(const spsc_queue &other) = delete;
+		spsc_queue &operator=(const spsc_queue &other) = delete;
+		~spsc_queue() {
+			size_t head = headIndex.load(std::memory_order_relaxed), tail = tailIndex.load(std::memory_order_relaxed);
+			for (; head != tail; ++head) {
+				reinterpret_cast<T*>(&slots[head & mask])->~T();
+			}
+			delete[] slots;
+		}
+		/**
+		 * Producer side. Returns false instead of blocking when the queue is full.
+		 */
+		bool try_push(const T &value) {
+			size_t tail = tailIndex.load(std::memory_order_relaxed);
+			if (tail - headCache > mask) {
+				headCache = headIndex.load(std::memory_order_acquire);
+				if (tail - headCache > mask) return false;
+			}
+			new (&slots[tail & mask]) T(value);
+			tailIndex.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+		/**
+		 * Consumer side. Returns false instead of blocking when the queue is empty.
+		 */
+		bool try_pop(T &value) {
+			size_t head = headIndex.load(std::memory_order_relaxed);
+			if (head == tailCache) {
+				tailCache = tailIndex.load(std::memory_order_acquire);
+				if (head == tailCache) return false;
+			}
+			T *p = reinterpret_cast<T*>(&slots[head & mask]);
+			value = std::move(*p);
+			p->~T();
+			headIndex.store(head + 1, std::memory_order_release);
+			return true;
+		}
+		size_t capacity() const {
+			return mask + 1;
+		}
+		/**
+		 * Only a snapshot while the other thread is running.
+		 */
+		size_t size() const {
+			return tailIndex.load(std::memory_order_acquire) - headIndex.load(std::memory_order_acquire);
+		}
+		bool empty() const {
+			return size() == 0;
+		}
+	};
+
+	/**
+	 * Bounded lock-free queue for any number of producers and consumers.
+	 * Every cell carries a sequence number telling which lap of the ring it is
+	 * ready for, so a thread claims a position with a single CAS and never waits
+	 * on a lock (Vyukov's bounded MPMC queue).
+	 * A claimed cell must be filled or emptied, so only moves that cannot throw
+	 * run after the CAS; try_push copies its argument before claiming.
+	 */
+	template<class T>
+	class mpmc_queue {
+		static_assert(std::is_nothrow_move_constructible<T>::value, "mpmc_queue needs a nothrow move constructor");
+		static_assert(std::is_nothrow_move_assignable<T>::value, "mpmc_queue needs a nothrow move assignment");
+	private:
+		struct cell {
+			std::atomic<size_t> sequence;
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+		};
+		cell *cells;
+		size_t mask;
+		char padding0[cacheLineSize];
+		std::atomic<size_t> enqueuePos;
+		char padding1[cacheLineSize];
+		std::atomic<size_t> dequeuePos;
+		char padding2[cacheLineSize];
+	public:
+		explicit mpmc_queue(size_t capacity) : enqueuePos(0), dequeuePos(0) {
+			if (capacity == 0) throw runtime_error();
+			capacity = ceilPowerOfTwo(capacity < 2 ? 2 : capacity);
+			mask = capacity - 1;
+			cells = new cell[capacity];
+			for (size_t i = 0; i < capacity; ++i) {
+				cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+		mpmc_queue(const mpmc_queue &other) = delete;
+		mpmc_queue &operator=(const mpmc_queue &other) = delete;
+		~mpmc_queue() {
+			size_t head = dequeuePos.load(std::memory_order_relaxed), tail = enqueuePos.load(std::memory_order_relaxed);
+			for (; head != tail; ++head) {
+				reinterpret_cast<T*>(&cells[head & mask].storage)->~T();
+			}
+			delete[] cells;
+		}
+		bool try_push(const T &value) {
+			T copy(value);
+			cell *c;
+			size_t pos = enqueuePos.load(std::memory_order_relaxed);
+			while (true) {
+				c = &cells[pos & mask];
+				size_t seq = c->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq - pos);
+				if (diff == 0) {
+					if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+				}
+				else if (diff < 0) return false;
+				else pos = enqueuePos.load(std::memory_order_relaxed);
+			}
+			new (&c->storage) T(std::move(copy));
+			c->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+		bool try_pop(T &value) {
+			cell *c;
+			size_t pos = dequeuePos.load(std::memory_order_relaxed);
+			while (true) {
+				c = &cells[pos & mask];
+				size_t seq = c->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+				if (diff == 0) {
+					if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+				}
+				else if (diff < 0) return false;
+				else pos = dequeuePos.load(std::memory_order_relaxed);
+			}
+			T *p = reinterpret_cast<T*>(&c->storage);
+			value = std::move(*p);
+			p->~T();
+			c->sequence.store(pos + mask + 1, std::memory_order_release);
+			return true;
+		}
+		size_t capacity() const {
+			return mask + 1;
+		}
+		/**
+		 * Only a snapshot while other threads are running.
+		 */
+		size_t size() const {
+			size_t tail = enqueuePos.load(std::memory_order_acquire), head = dequeuePos.load(std::memory_order_acquire);
+			return tail > head ? tail - head : 0;
+		}
+		bool empty() const {
+			return size() == 0;
+		}
+	};
+}
+
+#endif
@@ -5,6 +5,9 @@
 const size_t maximalSize = 300;
 
 #include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
 
 namespace sjtu {
 
@@ -232,6 +235,20 @@ namespace sjtu {
 			p->pv->nx = tl;
 			delete p;
 		}
+		size_t eraseRange(node<T> *first, node<T> *last) {
+			size_t count = 0;
+			node<T> *before = first->pv, *tmp;
+			while (first != last) {
+				tmp = first;
+				first = first->nx;
+				delete tmp;
+				count++;
+			}
+			before->nx = last;
+			last->pv = before;
+			elementSize -= count;
+			return count;
+		}
 	};
 
 
@@ -510,6 +527,53 @@ namespace sjtu {
 				return own != other.own || block != other.block || pointer != other.pointer;
 			}
 		};
+		/**
+		 * Walks the nodes of a single block, with no block boundary checks.
+		 * A block is a linked list of nodes, so this is bidirectional, not
+		 * random access.
+		 */
+		class local_iterator {
+			friend class deque<T>;
+		private:
+			node<T> *position;
+		public:
+			typedef std::bidirectional_iterator_tag iterator_category;
+			typedef T value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef T* pointer;
+			typedef T& reference;
+			local_iterator(node<T> *_position = NULL) : position(_position) {}
+			local_iterator& operator++() {
+				position = position->nx;
+				return *this;
+			}
+			local_iterator operator++(int) {
+				local_iterator tmp = *this;
+				position = position->nx;
+				return tmp;
+			}
+			local_iterator& operator--() {
+				position = position->pv;
+				return *this;
+			}
+			local_iterator operator--(int) {
+				local_iterator tmp = *this;
+				position = position->pv;
+				return tmp;
+			}
+			T& operator*() const {
+				return *(position->data);
+			}
+			T* operator->() const noexcept {
+				return position->data;
+			}
+			bool operator==(const local_iterator &other) const {
+				return position == other.position;
+			}
+			bool operator!=(const local_iterator &other) const {
+				return position != other.position;
+			}
+		};
 
 		deque() : currentSize(0) {
 			head = new blockList<T>();
@@ -533,6 +597,9 @@ namespace sjtu {
 			p->next = tail;
 			tail->prev = p;
 		}
+		deque(deque &&other) : deque() {
+			append(std::move(other));
+		}
 		~deque() {
 			currentSize = 0;
 			blockList<T> *p = head, *tmp;
@@ -566,6 +633,12 @@ namespace sjtu {
 			}
 			return *this;
 		}
+		deque &operator=(deque &&other) {
+			if (this == &other) return *this;
+			clear();
+			append(std::move(other));
+			return *this;
+		}
 		T & at(const size_t &pos) {
 			int count = 0;
 			blockList<T> *p = head->next;
@@ -746,6 +819,268 @@ namespace sjtu {
 				p->merge();
 			}
 		}
+		iterator insert(iterator iter, size_t n, const T &value) {
+			if (iter.own != head || !iter.block->belong(iter.pointer)) throw invalid_iterator();
+			blockList<T> *first = new blockList<T>(0, NULL, NULL), *last = first;
+			for (size_t i = 0; i < n; ++i) {
+				last = appendToChain(last, value);
+			}
+			return insertChain(iter.block, iter.pointer, first, last, n);
+		}
+		template<class InputIterator, class = typename std::enable_if<!std::is_integral<InputIterator>::value>::type>
+		iterator insert(iterator iter, InputIterator first, InputIterator last) {
+			if (iter.own != head || !iter.block->belong(iter.pointer)) throw invalid_iterator();
+			blockList<T> *chainHead = new blockList<T>(0, NULL, NULL), *chainTail = chainHead;
+			size_t count = 0;
+			for (; first != last; ++first, ++count) {
+				chainTail = appendToChain(chainTail, *first);
+			}
+			return insertChain(iter.block, iter.pointer, chainHead, chainTail, count);
+		}
+		iterator erase(iterator first, iterator last) {
+			if (first.own != head || last.own != head) throw invalid_iterator();
+			if (!first.block->belong(first.pointer) || !last.block->belong(last.pointer)) throw invalid_iterator();
+			if (first == last) return last;
+			blockList<T> *fb = first.block, *lb = last.block;
+			node<T> *fp = first.pointer, *lp = last.pointer;
+			if (fb == lb) {
+				node<T> *q = fp;
+				while (q != lp && q != fb->tl) q = q->nx;
+				if (q != lp) throw invalid_iterator();
+				currentSize -= fb->eraseRange(fp, lp);
+			}
+			else {
+				blockList<T> *q = fb;
+				while (q != lb && q != tail) q = q->next;
+				if (q != lb) throw invalid_iterator();
+				currentSize -= fb->eraseRange(fp, fb->tl);
+				blockList<T> *tmp;
+				q = fb->next;
+				while (q != lb) {
+					tmp = q;
+					q = q->next;
+					currentSize -= tmp->size();
+					tmp->clear();
+					delete tmp;
+				}
+				fb->next = lb;
+				lb->prev = fb;
+				if (lb != tail) currentSize -= lb->eraseRange(lb->begin(), lp);
+			}
+			if (fb != lb && fb->empty()) {
+				fb->disconnect();
+				fb->clear();
+				delete fb;
+			}
+			fb = lb->prev;
+			if (fb != head && lb != tail && fb->size() + lb->size() <= maximalSize) {
+				fb->merge();
+				lb = fb;
+			}
+			if (lb != tail && lb->next != tail && lb->size() + lb->next->size() <= maximalSize) {
+				lb->merge();
+			}
+			return iterator(head, lb, lp);
+		}
+		void assign(size_t n, const T &value) {
+			clear();
+			insert(end(), n, value);
+		}
+		template<class InputIterator, class = typename std::enable_if<!std::is_integral<InputIterator>::value>::type>
+		void assign(InputIterator first, InputIterator last) {
+			clear();
+			insert(end(), first, last);
+		}
+		void resize(size_t n) {
+			resize(n, T());
+		}
+		void resize(size_t n, const T &value) {
+			if (n < currentSize) erase(locate(n), end());
+			else if (n > currentSize) insert(end(), n - currentSize, value);
+		}
+		/**
+		 * Move all blocks of other to the back of this deque, leaving other empty.
+		 */
+		void append(deque &&other) {
+			if (this == &other || other.currentSize == 0) return;
+			blockList<T> *first = other.head->next, *prev = tail->prev;
+			currentSize += other.currentSize;
+			link(prev, first, other.tail->prev, tail);
+			other.release();
+			if (prev != head && prev->size() + first->size() <= maximalSize) prev->merge();
+		}
+		/**
+		 * Move all blocks of other to the front of this deque, leaving other empty.
+		 */
+		void prepend(deque &&other) {
+			if (this == &other || other.currentSize == 0) return;
+			blockList<T> *last = other.tail->prev, *next = head->next;
+			currentSize += other.currentSize;
+			link(head, other.head->next, last, next);
+			other.release();
+			if (next != tail && last->size() + next->size() <= maximalSize) last->merge();
+		}
+		/**
+		 * Move [iter, end()) into a new deque and return it.
+		 * Only the block holding iter is split; the rest are relinked, so
+		 * the cost is one block plus a size count over the moved blocks.
+		 */
+		deque split_at(iterator iter) {
+			if (iter.own != head || !iter.block->belong(iter.pointer)) throw invalid_iterator();
+			deque result;
+			blockList<T> *first = cut(iter.block, iter.pointer);
+			if (first == tail) return result;
+			blockList<T> *last = tail->prev;
+			size_t count = 0;
+			for (blockList<T> *p = first; p != tail; p = p->next) {
+				count += p->size();
+			}
+			first->prev->next = tail;
+			tail->prev = first->prev;
+			currentSize -= count;
+			result.link(result.head, first, last, result.tail);
+			result.currentSize = count;
+			return result;
+		}
+		/**
+		 * Call f(segmentBegin, segmentEnd) once for every block overlapped by [first, last).
+		 */
+		template<class Function>
+		static Function for_each_segment(iterator first, iterator last, Function f) {
+			if (first.own != last.own) throw invalid_iterator();
+			blockList<T> *b = first.block;
+			node<T> *p = first.pointer;
+			while (b != last.block) {
+				if (b->next == NULL) throw invalid_iterator();
+				f(local_iterator(p), local_iterator(b->tl));
+				b = b->next;
+				p = b->begin();
+			}
+			if (p != last.pointer) f(local_iterator(p), local_iterator(last.pointer));
+			return f;
+		}
+		template<class Function>
+		Function for_each_segment(Function f) {
+			return for_each_segment(begin(), end(), f);
+		}
+		/**
+		 * Segmented versions of the standard algorithms, found by argument-dependent lookup.
+		 */
+		template<class Function>
+		friend Function for_each(iterator first, iterator last, Function f) {
+			deque::for_each_segment(first, last, [&f](local_iterator p, local_iterator q) {
+				for (; p != q; ++p) f(*p);
+			});
+			return f;
+		}
+		template<class OutputIterator>
+		friend OutputIterator copy(iterator first, iterator last, OutputIterator out) {
+			deque::for_each_segment(first, last, [&out](local_iterator p, local_iterator q) {
+				for (; p != q; ++p, ++out) *out = *p;
+			});
+			return out;
+		}
+		friend void fill(iterator first, iterator last, const T &value) {
+			deque::for_each_segment(first, last, [&value](local_iterator p, local_iterator q) {
+				for (; p != q; ++p) *p = value;
+			});
+		}
+		template<class U>
+		friend U accumulate(iterator first, iterator last, U init) {
+			deque::for_each_segment(first, last, [&init](local_iterator p, local_iterator q) {
+				for (; p != q; ++p) init = init + *p;
+			});
+			return init;
+		}
+		friend iterator find(iterator first, iterator last, const T &value) {
+			return deque::findValue(first, last, value);
+		}
+	private:
+		static iterator findValue(iterator first, iterator last, const T &value) {
+			if (first.own != last.own) throw invalid_iterator();
+			blockList<T> *b = first.block;
+			node<T> *p = first.pointer;
+			while (true) {
+				if (b != last.block && b->next == NULL) throw invalid_iterator();
+				node<T> *stop = b == last.block ? last.pointer : b->tl;
+				for (; p != stop; p = p->nx) {
+					if (*(p->data) == value) return iterator(first.own, b, p);
+				}
+				if (b == last.block) return last;
+				b = b->next;
+				p = b->begin();
+			}
+		}
+		/**
+		 * Link the detached chain [first, last] between the adjacent blocks prev and next.
+		 */
+		void link(blockList<T> *prev, blockList<T> *first, blockList<T> *last, blockList<T> *next) {
+			prev->next = first;
+			first->prev = prev;
+			last->next = next;
+			next->prev = last;
+		}
+		/**
+		 * Forget every block without freeing it, after they were handed to another deque.
+		 */
+		void release() {
+			currentSize = 0;
+			head->next = tail;
+			tail->prev = head;
+		}
+		/**
+		 * Position of the pos-th element, found by skipping whole blocks.
+		 */
+		iterator locate(size_t pos) {
+			blockList<T> *p = head->next;
+			while (p != tail && pos >= p->size()) {
+				pos -= p->size();
+				p = p->next;
+			}
+			if (p == tail) return end();
+			return iterator(head, p, p->moveRight(p->begin(), pos));
+		}
+		/**
+		 * Cut the block list in front of pointer and return the block that starts there.
+		 */
+		blockList<T>* cut(blockList<T> *b, node<T> *pointer) {
+			if (b == tail || pointer == b->begin()) return b;
+			b->split(pointer);
+			return b->next;
+		}
+		/**
+		 * Append value to a detached chain of blocks, opening a new block when the last one is full.
+		 */
+		blockList<T>* appendToChain(blockList<T> *last, const T &value) {
+			if (last->full()) {
+				last->next = new blockList<T>(0, last, NULL);
+				last = last->next;
+			}
+			last->insertInTheEnd(value);
+			return last;
+		}
+		/**
+		 * Link the prebuilt chain [first, last] of count elements in front of pointer,
+		 * merging the boundary blocks when they fit into one.
+		 */
+		iterator insertChain(blockList<T> *b, node<T> *pointer, blockList<T> *first, blockList<T> *last, size_t count) {
+			if (count == 0) {
+				delete first;
+				return iterator(head, b, pointer);
+			}
+			currentSize += count;
+			blockList<T> *next = cut(b, pointer), *prev = next->prev;
+			link(prev, first, last, next);
+
+			blockList<T> *resultBlock = first;
+			node<T> *resultPointer = first->begin();
+			if (next != tail && last->size() + next->size() <= maximalSize) last->merge();
+			if (prev != head && prev->size() + first->size() <= maximalSize) {
+				prev->merge();
+				resultBlock = prev;
+			}
+			return iterator(head, resultBlock, resultPointer);
+		}
 	};
 }
 
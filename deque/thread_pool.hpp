@@ -0,0 +1,212 @@
+#ifndef SJTU_THREAD_POOL_HPP
+#define SJTU_THREAD_POOL_HPP
+
+#include "deque.hpp"
+#include "ws_deque.hpp"
+
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sjtu {
+
+	/**
+	 * Fixed set of worker threads, each owning a ws_deque of tasks.
+	 * Tasks submitted from a worker go to the bottom of its own deque; tasks from
+	 * other threads go to a shared injection queue. Idle workers steal from the
+	 * top of the other deques.
+	 */
+	class thread_pool {
+	private:
+		struct task {
+			std::function<void()> run;
+			task(const std::function<void()> &_run) : run(_run) {}
+		};
+		struct worker {
+			ws_deque<task*> tasks;
+			std::thread thread;
+		};
+		std::vector<worker*> workers;
+		deque<task*> injected;
+		std::mutex injectedLock;
+		std::mutex sleepLock;
+		std::condition_variable wakeup;
+		std::atomic<size_t> sleeping;
+		std::atomic<bool> stopping;
+
+		static thread_pool*& currentPool() {
+			static thread_local thread_pool *pool = NULL;
+			return pool;
+		}
+		static size_t& currentIndex() {
+			static thread_local size_t index = 0;
+			return index;
+		}
+		/**
+		 * self is the caller's worker index, or workers.size() for an outside thread.
+		 */
+		bool findTask(size_t self, task *&t) {
+			size_t n = workers.size();
+			if (self < n && workers[self]->tasks.pop(t)) return true;
+			{
+				std::lock_guard<std::mutex> lock(injectedLock);
+				if (!injected.empty()) {
+					t = injected.front();
+					injected.pop_front();
+					return true;
+				}
+			}
+			for (size_t i = 1; i <= n; ++i) {
+				size_t victim = (self + i) % n;
+				if (victim != self && workers[victim]->tasks.steal(t)) return true;
+			}
+			return false;
+		}
+		void execute(task *t) {
+			std::unique_ptr<task> owner(t);
+			owner->run();
+		}
+		void workerLoop(size_t index) {
+			currentPool() = this;
+			currentIndex() = index;
+			size_t idle = 0;
+			task *t;
+			while (true) {
+				if (findTask(index, t)) {
+					execute(t);
+					idle = 0;
+					continue;
+				}
+				if (stopping.load()) break;
+				if (++idle < 64) {
+					std::this_thread::yield();
+					continue;
+				}
+				std::unique_lock<std::mutex> lock(sleepLock);
+				++sleeping;
+				wakeup.wait_for(lock, std::chrono::milliseconds(1));
+				--sleeping;
+			}
+		}
+	public:
+		explicit thread_pool(size_t threads = std::thread::hardware_concurrency()) : sleeping(0), stopping(false) {
+			if (threads == 0) threads = 1;
+			for (size_t i = 0; i < threads; ++i) {
+				workers.push_back(new worker());
+			}
+			for (size_t i = 0; i < threads; ++i) {
+				workers[i]->thread = std::thread(&thread_pool::workerLoop, this, i);
+			}
+		}
+		thread_pool(const thread_pool &other) = delete;
+		thread_pool &operator=(const thread_pool &other) = delete;
+		~thread_pool() {
+			stopping.store(true);
+			wakeup.notify_all();
+			for (size_t i = 0; i < workers.size(); ++i) {
+				workers[i]->thread.join();
+			}
+			task *t;
+			for (size_t i = 0; i < workers.size(); ++i) {
+				while (workers[i]->tasks.pop(t)) delete t;
+				delete workers[i];
+			}
+			while (!injected.empty()) {
+				delete injected.front();
+				injected.pop_front();
+			}
+		}
+		size_t size() const {
+			return workers.size();
+		}
+		/**
+		 * A task that throws on a worker thread ends the program, as with
+		 * std::thread; run it through a task_group to get the exception back.
+		 */
+		template<class Function>
+		void submit(Function f) {
+			task *t = new task(f);
+			if (currentPool() == this) workers[currentIndex()]->tasks.push(t);
+			else {
+				std::lock_guard<std::mutex> lock(injectedLock);
+				injected.push_back(t);
+			}
+			if (sleeping.load() > 0) wakeup.notify_one();
+		}
+		/**
+		 * Run pending tasks on the calling thread until done() holds, so a task
+		 * waiting for its children keeps the pool busy instead of blocking it.
+		 */
+		template<class Predicate>
+		void run_until(Predicate done) {
+			size_t self = currentPool() == this ? currentIndex() : workers.size();
+			task *t;
+			while (!done()) {
+				if (findTask(self, t)) execute(t);
+				else std::this_thread::yield();
+			}
+		}
+	};
+
+	/**
+	 * Fork-join helper: run() spawns a task on the pool, wait() helps until all
+	 * tasks spawned through this group have finished and rethrows the first
+	 * exception any of them threw. The destructor waits but drops exceptions.
+	 */
+	class task_group {
+	private:
+		struct finish_guard {
+			std::atomic<size_t> &pending;
+			~finish_guard() {
+				pending.fetch_sub(1, std::memory_order_release);
+			}
+		};
+		thread_pool &pool;
+		std::atomic<size_t> pending;
+		std::mutex errorLock;
+		std::exception_ptr error;
+
+		void join() {
+			pool.run_until([this]() { return pending.load(std::memory_order_acquire) == 0; });
+		}
+	public:
+		explicit task_group(thread_pool &_pool) : pool(_pool), pending(0) {}
+		task_group(const task_group &other) = delete;
+		task_group &operator=(const task_group &other) = delete;
+		~task_group() {
+			join();
+		}
+		template<class Function>
+		void run(Function f) {
+			pending.fetch_add(1, std::memory_order_relaxed);
+			pool.submit([this, f]() {
+				finish_guard guard = {pending};
+				try {
+					f();
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(errorLock);
+					if (!error) error = std::current_exception();
+				}
+			});
+		}
+		void wait() {
+			join();
+			std::exception_ptr first;
+			{
+				std::lock_guard<std::mutex> lock(errorLock);
+				first = error;
+				error = NULL;
+			}
+			if (first) std::rethrow_exception(first);
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef SJTU_WS_DEQUE_HPP
+#define SJTU_WS_DEQUE_HPP
+
+#include "exceptions.hpp"
+
+#include <cstddef>
+#include <atomic>
+#include <type_traits>
+
+namespace sjtu {
+
+	/**
+	 * Chase-Lev work-stealing deque.
+	 * The owner thread calls push and pop at the bottom; any other thread may call
+	 * steal at the top. Memory orderings follow Le, Pop, Cohen and Zappa Nardelli,
+	 * "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+	 * A thief may read a slot the owner is about to overwrite, so T must be
+	 * trivially copyable; store pointers to larger tasks.
+	 */
+	template<class T>
+	class ws_deque {
+		static_assert(std::is_trivially_copyable<T>::value, "ws_deque needs a trivially copyable T");
+	private:
+		struct circularArray {
+			long long capacity;
+			std::atomic<T> *items;
+			circularArray *previous;
+			circularArray(long long _capacity, circularArray *_previous = NULL) : capacity(_capacity), previous(_previous) {
+				items = new std::atomic<T>[capacity];
+			}
+			~circularArray() {
+				delete[] items;
+			}
+			T get(long long i) const {
+				return items[i & (capacity - 1)].load(std::memory_order_relaxed);
+			}
+			void put(long long i, const T &value) {
+				items[i & (capacity - 1)].store(value, std::memory_order_relaxed);
+			}
+			/**
+			 * The old array stays reachable through previous, because a thief may
+			 * still be reading from it; it is freed with the deque.
+			 */
+			circularArray* grow(long long bottom, long long top) {
+				circularArray *result = new circularArray(capacity << 1, this);
+				for (long long i = top; i < bottom; ++i) {
+					result->put(i, get(i));
+				}
+				return result;
+			}
+		};
+		char padding0[64];
+		std::atomic<long long> top;
+		char padding1[64];
+		std::atomic<long long> bottom;
+		std::atomic<circularArray*> array;
+		char padding2[64];
+	public:
+		explicit ws_deque(size_t capacity = 64) : top(0), bottom(0) {
+			long long size = 2;
+			while (size < static_cast<long long>(capacity)) size <<= 1;
+			array.store(new circularArray(size), std::memory_order_relaxed);
+		}
+		ws_deque(const ws_deque &other) = delete;
+		ws_deque &operator=(const ws_deque &other) = delete;
+		~ws_deque() {
+			circularArray *p = array.load(std::memory_order_relaxed), *tmp;
+			while (p != NULL) {
+				tmp = p;
+				p = p->previous;
+				delete tmp;
+			}
+		}
+		/**
+		 * Owner only.
+		 */
+		void push(const T &value) {
+			long long b = bottom.load(std::memory_order_relaxed);
+			long long t = top.load(std::memory_order_acquire);
+			circularArray *a = array.load(std::memory_order_relaxed);
+			if (b - t > a->capacity - 1) {
+				a = a->grow(b, t);
+				array.store(a, std::memory_order_release);
+			}
+			a->put(b, value);
+			bottom.store(b + 1, std::memory_order_release);
+		}
+		/**
+		 * Owner only. Takes the most recently pushed element; false when empty
+		 * or when a thief won the race for the last element.
+		 */
+		bool pop(T &value) {
+			long long b = bottom.load(std::memory_order_relaxed) - 1;
+			circularArray *a = array.load(std::memory_order_relaxed);
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			long long t = top.load(std::memory_order_relaxed);
+			if (t > b) {
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return false;
+			}
+			value = a->get(b);
+			if (t == b) {
+				bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return won;
+			}
+			return true;
+		}
+		/**
+		 * Any thread. Takes the oldest element; false when empty or on a lost race.
+		 */
+		bool steal(T &value) {
+			long long t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			long long b = bottom.load(std::memory_order_acquire);
+			if (t >= b) return false;
+			circularArray *a = array.load(std::memory_order_acquire);
+			T result = a->get(t);
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return false;
+			value = result;
+			return true;
+		}
+		/**
+		 * Only a snapshot while other threads are running.
+		 */
+		size_t size() const {
+			long long b = bottom.load(std::memory_order_relaxed), t = top.load(std::memory_order_relaxed);
+			return b > t ? static_cast<size_t>(b - t) : 0;
+		}
+		bool empty() const {
+			return size() == 0;
+		}
+	};
+}
+
+#endif
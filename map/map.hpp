@@ -15,7 +15,7 @@ template<
 	class Key,
 	class T,		
 	class Compare = std::less<Key>
-> class map {
+> class map : private compare_holder<Compare> {
 public:
 	typedef pair<const Key, T> value_type;
 private:
@@ -34,10 +34,10 @@ private:
 	};
 	node *root, *nil, *leftMost, *rightMost;
 	size_t currentSize;
-	Compare comparator;
+	using compare_holder<Compare>::comparator;
 public:
 	int compare(const Key &a, const Key &b) const {
-		return comparator(a, b) ? -1 : (comparator(b, a) ? 1 : 0);
+		return comparator()(a, b) ? -1 : (comparator()(b, a) ? 1 : 0);
 	}
 	node* findNode(node *p, const Key &key) const {
 		if (p == nil) return p;
@@ -214,13 +214,18 @@ public:
 		root = leftMost = rightMost = nil = new node();
 		nil->leftChild = nil->rightChild = nil->father = nil->prev = nil->next = nil;
 	}
-	map(const map &other) : currentSize(other.currentSize) {
+	explicit map(const Compare &_comparator) : compare_holder<Compare>(_comparator), currentSize(0) {
+		root = leftMost = rightMost = nil = new node();
+		nil->leftChild = nil->rightChild = nil->father = nil->prev = nil->next = nil;
+	}
+	map(const map &other) : compare_holder<Compare>(other), currentSize(other.currentSize) {
 		root = leftMost = rightMost = nil = new node();
 		nil->leftChild = nil->rightChild = nil->father = nil->prev = nil->next = nil;
 		copy(other.root, root, nil, nil, nil, leftMost, rightMost);
 	}
 	map & operator=(const map &other) {
 		if (this == &other) return *this;
+		compare_holder<Compare>::operator=(other);
 		currentSize = other.currentSize;
 		if (root != nil) destory(root);
 		nil->color = BLACK;
@@ -359,11 +364,11 @@ public:
 		}
 		node *fa = root;
 		while (fa != nil) {			
-			if (comparator(key, fa->data->first)) {
+			if (comparator()(key, fa->data->first)) {
 				if (fa->leftChild == nil) break;
 				fa = fa->leftChild;
 			}
-			else if (comparator(fa->data->first, key)) {
+			else if (comparator()(fa->data->first, key)) {
 				if (fa->rightChild == nil) break;
 				fa = fa->rightChild;
 			}
@@ -371,7 +376,7 @@ public:
 		}
 		currentSize++;
 		node *self = new node(value, nil, nil, fa, nil, nil, RED);
-		if (comparator(key, fa->data->first)) fa->leftChild = self;
+		if (comparator()(key, fa->data->first)) fa->leftChild = self;
 		else fa->rightChild = self;
 
 		insertFixUp(self);		
@@ -2,6 +2,7 @@
 #define SJTU_UTILITY_HPP
 
 #include <utility>
+#include <type_traits>
 
 namespace sjtu {
 
@@ -22,6 +23,44 @@ public:
 	pair(pair<U1, U2> &&other) : first(other.first), second(other.second) {}
 };
 
+/**
+ * is_final for C++11, where only the compiler builtin has it.
+ */
+template<class T>
+struct is_final_class : std::integral_constant<bool,
+#if __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+	std::is_final<T>::value
+#else
+	__is_final(T)
+#endif
+> {};
+
+/**
+ * Holds a container's comparator. Containers inherit from it, so an empty,
+ * non-final comparator such as std::less takes no space (empty base
+ * optimization), while any other one is stored per container.
+ * comparator() hands out a modifiable reference even from const members,
+ * so comparators whose operator() is not const keep working.
+ */
+template<class Compare, bool = std::is_class<Compare>::value && std::is_empty<Compare>::value && !is_final_class<Compare>::value>
+class compare_holder : private Compare {
+public:
+	compare_holder(const Compare &_comparator = Compare()) : Compare(_comparator) {}
+	Compare & comparator() const {
+		return const_cast<compare_holder &>(*this);
+	}
+};
+
+template<class Compare>
+class compare_holder<Compare, false> {
+	mutable Compare value;
+public:
+	compare_holder(const Compare &_comparator = Compare()) : value(_comparator) {}
+	Compare & comparator() const {
+		return value;
+	}
+};
+
 }
 
 #endif
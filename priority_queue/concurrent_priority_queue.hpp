@@ -0,0 +1,139 @@
+#ifndef SJTU_CONCURRENT_PRIORITY_QUEUE_HPP
+#define SJTU_CONCURRENT_PRIORITY_QUEUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+#include "exceptions.hpp"
+#include "utility.hpp"
+#include "priority_queue.hpp"
+
+namespace sjtu {
+
+	/**
+	 * MultiQueue: a relaxed concurrent priority queue made of several locked
+	 * priority_queue shards. push goes to a random shard; pop samples `choices`
+	 * shards and pops the best of their tops. One shard gives the exact order,
+	 * more shards and fewer choices trade strictness for throughput.
+	 */
+	template<typename T, class Compare = std::less<T>>
+	class concurrent_priority_queue : private compare_holder<Compare> {
+	private:
+		/**
+		 * One cache line per shard, so neighbouring locks do not share one.
+		 */
+		struct alignas(64) shard {
+			std::mutex lock;
+			priority_queue<T, Compare> queue;
+			explicit shard(const Compare &_comparator) : queue(_comparator) {}
+		};
+		void *storage;
+		shard *shards;
+		size_t shardCount, choices;
+		using compare_holder<Compare>::comparator;
+		std::atomic<size_t> currentSize;
+
+		static size_t random() {
+			static thread_local size_t state = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			return state;
+		}
+	public:
+		explicit concurrent_priority_queue(size_t _shardCount = 2 * std::thread::hardware_concurrency(), size_t _choices = 2, const Compare &_comparator = Compare())
+			: compare_holder<Compare>(_comparator), shardCount(_shardCount == 0 ? 1 : _shardCount), choices(_choices == 0 ? 1 : _choices), currentSize(0) {
+			// operator new only honours alignas(64) from C++17 on, so align by hand.
+			storage = ::operator new(shardCount * sizeof(shard) + alignof(shard));
+			shards = reinterpret_cast<shard*>((reinterpret_cast<uintptr_t>(storage) + alignof(shard) - 1) & ~uintptr_t(alignof(shard) - 1));
+			size_t built = 0;
+			try {
+				for (; built < shardCount; ++built) {
+					new (&shards[built]) shard(_comparator);
+				}
+			} catch (...) {
+				while (built > 0) shards[--built].~shard();
+				::operator delete(storage);
+				throw;
+			}
+		}
+		concurrent_priority_queue(const concurrent_priority_queue &other) = delete;
+		concurrent_priority_queue &operator=(const concurrent_priority_queue &other) = delete;
+		~concurrent_priority_queue() {
+			for (size_t i = 0; i < shardCount; ++i) {
+				shards[i].~shard();
+			}
+			::operator delete(storage);
+		}
+		void push(const T &e) {
+			shard *s = &shards[random() % shardCount];
+			for (size_t attempt = 0; !s->lock.try_lock(); ++attempt) {
+				if (attempt == shardCount) {
+					s->lock.lock();
+					break;
+				}
+				s = &shards[random() % shardCount];
+			}
+			s->queue.push(e);
+			currentSize.fetch_add(1, std::memory_order_relaxed);
+			s->lock.unlock();
+		}
+		/**
+		 * Pop one of the best elements; false only once the queue is seen empty.
+		 * When sampling and the full scan both come up empty while other threads
+		 * are still pushing and popping, it tries again.
+		 */
+		bool try_pop(T &result) {
+			while (currentSize.load(std::memory_order_relaxed) > 0) {
+				shard *best = NULL;
+				for (size_t i = 0; i < choices; ++i) {
+					shard *s = &shards[random() % shardCount];
+					if (s == best || !s->lock.try_lock()) continue;
+					if (s->queue.empty()) {
+						s->lock.unlock();
+						continue;
+					}
+					if (best == NULL || comparator()(best->queue.top(), s->queue.top())) {
+						if (best != NULL) best->lock.unlock();
+						best = s;
+					}
+					else s->lock.unlock();
+				}
+				if (best == NULL) best = lockNonEmpty();
+				if (best == NULL) continue;
+				result = best->queue.top();
+				best->queue.pop();
+				currentSize.fetch_sub(1, std::memory_order_relaxed);
+				best->lock.unlock();
+				return true;
+			}
+			return false;
+		}
+		size_t size() const {
+			return currentSize.load(std::memory_order_relaxed);
+		}
+		bool empty() const {
+			return size() == 0;
+		}
+	private:
+		/**
+		 * Fallback when sampling only found empty or busy shards: scan all of them.
+		 */
+		shard* lockNonEmpty() {
+			size_t start = random() % shardCount;
+			for (size_t i = 0; i < shardCount; ++i) {
+				shard *s = &shards[(start + i) % shardCount];
+				s->lock.lock();
+				if (!s->queue.empty()) return s;
+				s->lock.unlock();
+			}
+			return NULL;
+		}
+	};
+}
+#endif
@@ -0,0 +1,158 @@
+#ifndef SJTU_MINMAX_PRIORITY_QUEUE_HPP
+#define SJTU_MINMAX_PRIORITY_QUEUE_HPP
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <utility>
+#include "exceptions.hpp"
+#include "utility.hpp"
+
+namespace sjtu {
+
+	/**
+	 * Double-ended priority queue on an array min-max heap.
+	 * top_max is what priority_queue<T, Compare>::top would return, top_min is
+	 * the opposite end. Nodes on even levels are no greater than their
+	 * descendants, nodes on odd levels no less.
+	 */
+	template<typename T, class Compare = std::less<T>>
+	class minmax_priority_queue : private compare_holder<Compare> {
+	private:
+		T *data;
+		size_t currentSize, capacity;
+		using compare_holder<Compare>::comparator;
+
+		static bool isMinLevel(size_t pos) {
+			size_t level = 0;
+			for (++pos; pos > 1; pos >>= 1) ++level;
+			return (level & 1) == 0;
+		}
+		/**
+		 * Whether a belongs above b on a level of the given kind.
+		 */
+		bool before(const T &a, const T &b, bool minLevel) const {
+			return minLevel ? comparator()(a, b) : comparator()(b, a);
+		}
+		void exchange(size_t a, size_t b) {
+			T tmp = std::move(data[a]);
+			data[a] = std::move(data[b]);
+			data[b] = std::move(tmp);
+		}
+		void doubleSpace() {
+			size_t newCapacity = capacity == 0 ? 16 : capacity << 1;
+			T *newData = static_cast<T*>(::operator new(sizeof(T) * newCapacity));
+			for (size_t i = 0; i < currentSize; ++i) {
+				new (newData + i) T(std::move(data[i]));
+				data[i].~T();
+			}
+			::operator delete(data);
+			data = newData;
+			capacity = newCapacity;
+		}
+		void bubbleUp(size_t pos) {
+			if (pos == 0) return;
+			size_t parent = (pos - 1) >> 1;
+			bool minLevel = isMinLevel(pos);
+			if (before(data[parent], data[pos], minLevel)) {
+				exchange(pos, parent);
+				pos = parent;
+				minLevel = !minLevel;
+			}
+			while (pos > 2) {
+				size_t grandparent = (((pos - 1) >> 1) - 1) >> 1;
+				if (!before(data[pos], data[grandparent], minLevel)) break;
+				exchange(pos, grandparent);
+				pos = grandparent;
+			}
+		}
+		void trickleDown(size_t pos) {
+			bool minLevel = isMinLevel(pos);
+			while (true) {
+				size_t child = (pos << 1) + 1;
+				if (child >= currentSize) return;
+				size_t best = child;
+				if (child + 1 < currentSize && before(data[child + 1], data[best], minLevel)) best = child + 1;
+				size_t grandchild = (child << 1) + 1;
+				for (size_t i = grandchild; i < grandchild + 4 && i < currentSize; ++i) {
+					if (before(data[i], data[best], minLevel)) best = i;
+				}
+				if (!before(data[best], data[pos], minLevel)) return;
+				exchange(best, pos);
+				if (best < grandchild) return;
+				size_t parent = (best - 1) >> 1;
+				if (before(data[parent], data[best], minLevel)) exchange(best, parent);
+				pos = best;
+			}
+		}
+		void removeAt(size_t pos) {
+			--currentSize;
+			if (pos != currentSize) data[pos] = std::move(data[currentSize]);
+			data[currentSize].~T();
+			if (pos < currentSize) trickleDown(pos);
+		}
+		size_t maxIndex() const {
+			if (currentSize == 1) return 0;
+			if (currentSize == 2 || comparator()(data[2], data[1])) return 1;
+			return 2;
+		}
+	public:
+		explicit minmax_priority_queue(const Compare &_comparator = Compare()) : compare_holder<Compare>(_comparator), data(NULL), currentSize(0), capacity(0) {}
+		minmax_priority_queue(const minmax_priority_queue &other) : compare_holder<Compare>(other), data(NULL), currentSize(0), capacity(other.currentSize) {
+			if (capacity > 0) data = static_cast<T*>(::operator new(sizeof(T) * capacity));
+			for (; currentSize < other.currentSize; ++currentSize) {
+				new (data + currentSize) T(other.data[currentSize]);
+			}
+		}
+		minmax_priority_queue &operator=(const minmax_priority_queue &other) {
+			if (this == &other) return *this;
+			clear();
+			::operator delete(data);
+			compare_holder<Compare>::operator=(other);
+			capacity = other.currentSize;
+			data = capacity > 0 ? static_cast<T*>(::operator new(sizeof(T) * capacity)) : NULL;
+			for (; currentSize < other.currentSize; ++currentSize) {
+				new (data + currentSize) T(other.data[currentSize]);
+			}
+			return *this;
+		}
+		~minmax_priority_queue() {
+			clear();
+			::operator delete(data);
+		}
+		void push(const T &e) {
+			if (currentSize == capacity) doubleSpace();
+			new (data + currentSize) T(e);
+			bubbleUp(currentSize++);
+		}
+		const T & top_min() const {
+			if (currentSize == 0) throw container_is_empty();
+			return data[0];
+		}
+		const T & top_max() const {
+			if (currentSize == 0) throw container_is_empty();
+			return data[maxIndex()];
+		}
+		void pop_min() {
+			if (currentSize == 0) throw container_is_empty();
+			removeAt(0);
+		}
+		void pop_max() {
+			if (currentSize == 0) throw container_is_empty();
+			removeAt(maxIndex());
+		}
+		size_t size() const {
+			return currentSize;
+		}
+		bool empty() const {
+			return currentSize == 0;
+		}
+		void clear() {
+			for (size_t i = 0; i < currentSize; ++i) {
+				data[i].~T();
+			}
+			currentSize = 0;
+		}
+	};
+}
+#endif
@@ -0,0 +1,133 @@
+#ifndef SJTU_PERSISTENT_PRIORITY_QUEUE_HPP
+#define SJTU_PERSISTENT_PRIORITY_QUEUE_HPP
+
+#include <cstddef>
+#include <functional>
+#include "exceptions.hpp"
+#include "utility.hpp"
+
+namespace sjtu {
+
+	/**
+	 * Immutable leftist heap. push, pop and merge leave the queue unchanged and
+	 * return a new version; merging only rebuilds the right spine, so a new
+	 * version costs O(log n) nodes and shares every other subtree with the old
+	 * ones through reference counts. Copies are O(1).
+	 * Reference counts are not atomic: share versions between threads only
+	 * with outside synchronization.
+	 */
+	template<typename T, class Compare = std::less<T>>
+	class persistent_priority_queue : private compare_holder<Compare> {
+	private:
+		struct node {
+			T value;
+			int distance;
+			size_t refCount;
+			node *leftChild, *rightChild;
+			node(const T &_value, node *_leftChild = NULL, node *_rightChild = NULL) : value(_value), distance(0), refCount(1), leftChild(_leftChild), rightChild(_rightChild) {}
+			void maintain() {
+				int leftChildDistance = leftChild == NULL ? -1 : leftChild->distance;
+				int rightChildDistance = rightChild == NULL ? -1 : rightChild->distance;
+				if (leftChildDistance < rightChildDistance) {
+					node *tmp = leftChild;
+					leftChild = rightChild;
+					rightChild = tmp;
+					distance = leftChildDistance + 1;
+				}
+				else distance = rightChildDistance + 1;
+			}
+		};
+		node *root;
+		size_t currentSize;
+
+		persistent_priority_queue(const compare_holder<Compare> &comparator, node *_root, size_t _currentSize) : compare_holder<Compare>(comparator), root(_root), currentSize(_currentSize) {}
+		static node* acquire(node *p) {
+			if (p != NULL) ++p->refCount;
+			return p;
+		}
+		/**
+		 * Drop one reference; frees with an explicit stack because a leftist
+		 * tree's left spine can be as long as the heap.
+		 */
+		static void release(node *p) {
+			if (p == NULL || --p->refCount > 0) return;
+			size_t stackSize = 0, capacity = 16;
+			node **stack = new node*[capacity];
+			stack[stackSize++] = p;
+			while (stackSize > 0) {
+				node *q = stack[--stackSize];
+				node *children[2] = {q->leftChild, q->rightChild};
+				delete q;
+				for (size_t i = 0; i < 2; ++i) {
+					if (children[i] == NULL || --children[i]->refCount > 0) continue;
+					if (stackSize == capacity) {
+						node **newStack = new node*[capacity << 1];
+						for (size_t j = 0; j < stackSize; ++j) {
+							newStack[j] = stack[j];
+						}
+						delete[] stack;
+						stack = newStack;
+						capacity <<= 1;
+					}
+					stack[stackSize++] = children[i];
+				}
+			}
+			delete[] stack;
+		}
+		/**
+		 * Returns a new reference; a and b are only read.
+		 */
+		node* mergeNode(node *a, node *b) const {
+			if (a == NULL) return acquire(b);
+			if (b == NULL) return acquire(a);
+			if (this->comparator()(a->value, b->value)) {
+				node *tmp = a;
+				a = b;
+				b = tmp;
+			}
+			node *result = new node(a->value, acquire(a->leftChild), mergeNode(a->rightChild, b));
+			result->maintain();
+			return result;
+		}
+	public:
+		persistent_priority_queue() : root(NULL), currentSize(0) {}
+		explicit persistent_priority_queue(const Compare &_comparator) : compare_holder<Compare>(_comparator), root(NULL), currentSize(0) {}
+		persistent_priority_queue(const persistent_priority_queue &other) : compare_holder<Compare>(other), root(acquire(other.root)), currentSize(other.currentSize) {}
+		persistent_priority_queue &operator=(const persistent_priority_queue &other) {
+			if (this == &other) return *this;
+			compare_holder<Compare>::operator=(other);
+			node *old = root;
+			root = acquire(other.root);
+			currentSize = other.currentSize;
+			release(old);
+			return *this;
+		}
+		~persistent_priority_queue() {
+			release(root);
+		}
+		const T & top() const {
+			if (currentSize == 0) throw container_is_empty();
+			return root->value;
+		}
+		persistent_priority_queue push(const T &e) const {
+			node *p = new node(e);
+			node *result = mergeNode(root, p);
+			release(p);
+			return persistent_priority_queue(*this, result, currentSize + 1);
+		}
+		persistent_priority_queue pop() const {
+			if (currentSize == 0) throw container_is_empty();
+			return persistent_priority_queue(*this, mergeNode(root->leftChild, root->rightChild), currentSize - 1);
+		}
+		persistent_priority_queue merge(const persistent_priority_queue &other) const {
+			return persistent_priority_queue(*this, mergeNode(root, other.root), currentSize + other.currentSize);
+		}
+		size_t size() const {
+			return currentSize;
+		}
+		bool empty() const {
+			return currentSize == 0;
+		}
+	};
+}
+#endif
@@ -3,7 +3,12 @@
 
 #include <cstddef>
 #include <functional>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include "exceptions.hpp"
+#include "utility.hpp"
 
 namespace sjtu {
 
@@ -14,35 +19,21 @@ namespace sjtu {
 		a = b;
 		b = tmp;
 	}
+	template<class RandomIt, class Compare>
+	void heap_sort(RandomIt first, RandomIt last, Compare comp);
+
 	template<typename T, class Compare = std::less<T>>
-	class priority_queue {
+	class priority_queue : private compare_holder<Compare> {
+		template<class RandomIt, class C>
+		friend void heap_sort(RandomIt first, RandomIt last, C comp);
 	private:
 		struct node {
 			T value;
 			int distance;
 			node *leftChild, *rightChild;
-			node(T _value, node *_leftChild = NULL, node *_rightChild = NULL) : value(_value), leftChild(_leftChild), rightChild(_rightChild), distance(0) {}
-			node(node *other) : value(other->value), distance(other->distance) {
-				if (other->leftChild != NULL) {
-					leftChild = new node(other->leftChild);
-				}
-				else leftChild = NULL;
-				if (other->rightChild != NULL) {	
-					rightChild = new node(other->rightChild);
-				}
-				else rightChild = NULL;
-			}
+			node(const T &_value, node *_leftChild = NULL, node *_rightChild = NULL) : value(_value), distance(0), leftChild(_leftChild), rightChild(_rightChild) {}
+			node(T &&_value) : value(std::move(_value)), distance(0), leftChild(NULL), rightChild(NULL) {}
 			~node() {}
-			void clear() {
-				if (leftChild != NULL) {
-					leftChild->clear();
-					delete leftChild;
-				}
-				if (rightChild != NULL) {
-					rightChild->clear();
-					delete rightChild;
-				}
-			}
 			void maintain() {
 				int leftChildDistance = leftChild == NULL ? -1 : leftChild->distance;
 				int rightChildDistance = rightChild == NULL ? -1 : rightChild->distance;
@@ -53,60 +44,328 @@ namespace sjtu {
 				else distance = rightChildDistance + 1;
 			}
 		};
-		node *root;
+		/**
+		 * A heap handed over by lazy_merge and not yet merged into root.
+		 */
+		struct pendingTree {
+			node *root;
+			pendingTree *next;
+			pendingTree(node *_root, pendingTree *_next = NULL) : root(_root), next(_next) {}
+		};
+		/**
+		 * Nodes are bump-allocated from chunks owned by the queue. A popped
+		 * node goes on freeList (linked through leftChild, distance set to -1)
+		 * and is reused by the next push. A slot is only taken once its value
+		 * has been constructed, so a throwing copy leaves the chunks as they were.
+		 */
+		struct chunk {
+			node *slots;
+			size_t used, capacity;
+			chunk *next;
+			chunk(size_t _capacity, chunk *_next) : used(0), capacity(_capacity), next(_next) {
+				slots = static_cast<node*>(::operator new(sizeof(node) * capacity));
+			}
+			~chunk() {
+				::operator delete(slots);
+			}
+		};
+		mutable node *root;
+		mutable pendingTree *pendingHead, *pendingTail;
 		size_t currentSize;
+		chunk *chunks;
+		node *freeList;
+
+		node* allocate(const T &value) {
+			if (freeList != NULL) {
+				node *p = freeList, *next = freeList->leftChild;
+				try {
+					new (p) node(value);
+				} catch (...) {
+					p->distance = -1;
+					p->leftChild = next;
+					throw;
+				}
+				freeList = next;
+				return p;
+			}
+			if (chunks == NULL || chunks->used == chunks->capacity) {
+				size_t capacity = chunks == NULL ? 32 : chunks->capacity << 1;
+				chunks = new chunk(capacity > 4096 ? 4096 : capacity, chunks);
+			}
+			node *p = new (chunks->slots + chunks->used) node(value);
+			++chunks->used;
+			return p;
+		}
+		void deallocate(node *p) {
+			p->value.~T();
+			p->distance = -1;
+			p->leftChild = freeList;
+			freeList = p;
+		}
+		/**
+		 * Take over other's chunks, so its nodes stay valid after a merge.
+		 */
+		void adoptChunks(priority_queue &other) {
+			if (other.chunks == NULL) return;
+			chunk *last = other.chunks;
+			while (last->next != NULL) last = last->next;
+			if (chunks == NULL) chunks = other.chunks;
+			else {
+				last->next = chunks->next;
+				chunks->next = other.chunks;
+			}
+			other.chunks = NULL;
+			other.freeList = NULL;
+		}
+		/**
+		 * Free every chunk at once. Values are destroyed by a linear scan of the
+		 * chunks, skipped entirely when T is trivially destructible.
+		 */
+		void releaseChunks() {
+			chunk *tmp;
+			while (chunks != NULL) {
+				if (!std::is_trivially_destructible<T>::value) {
+					for (size_t i = 0; i < chunks->used; ++i) {
+						if (chunks->slots[i].distance != -1) chunks->slots[i].value.~T();
+					}
+				}
+				tmp = chunks;
+				chunks = chunks->next;
+				delete tmp;
+			}
+			freeList = NULL;
+		}
+		node* copyTree(const node *other) {
+			if (other == NULL) return NULL;
+			node *p = allocate(other->value);
+			p->distance = other->distance;
+			p->leftChild = copyTree(other->leftChild);
+			p->rightChild = copyTree(other->rightChild);
+			return p;
+		}
+		/**
+		 * Merge the pending heaps pairwise in rounds, then into root.
+		 */
+		void consolidate() const {
+			if (pendingHead == NULL) return;
+			while (pendingHead != pendingTail) {
+				pendingTree *a = pendingHead, *b = a->next;
+				pendingHead = b->next;
+				a->root = mergeNode(a->root, b->root);
+				a->next = NULL;
+				delete b;
+				if (pendingHead == NULL) pendingHead = a;
+				else pendingTail->next = a;
+				pendingTail = a;
+			}
+			root = mergeNode(root, pendingHead->root);
+			delete pendingHead;
+			pendingHead = pendingTail = NULL;
+		}
+		void clearPending() {
+			pendingTree *tmp;
+			while (pendingHead != NULL) {
+				tmp = pendingHead;
+				pendingHead = pendingHead->next;
+				delete tmp;
+			}
+			pendingTail = NULL;
+		}
 	public:
-		priority_queue() : root(NULL), currentSize(0) {}
-		priority_queue(const priority_queue &other) : currentSize(other.currentSize) {
-			if (other.root != NULL) {
-				root = new node(other.root);
+		/**
+		 * Visits the elements in priority order without touching the queue.
+		 * Holds a small heap of the frontier nodes, the best of which is the
+		 * current element; ++ replaces it by its children, so reaching the k-th
+		 * element costs O(k log k). A copy has its own frontier, so copies
+		 * advance independently and the iterator is forward.
+		 */
+		class ordered_iterator {
+			friend class priority_queue;
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef T value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const T* pointer;
+			typedef const T& reference;
+		private:
+			const priority_queue *own;
+			const node **frontier;
+			size_t frontierSize, capacity;
+
+			bool before(const node *a, const node *b) const {
+				return own->comparator()(b->value, a->value);
+			}
+			void push(const node *p) {
+				if (p == NULL) return;
+				if (frontierSize == capacity) {
+					capacity = capacity == 0 ? 16 : capacity << 1;
+					const node **newFrontier = new const node*[capacity];
+					for (size_t i = 0; i < frontierSize; ++i) {
+						newFrontier[i] = frontier[i];
+					}
+					delete[] frontier;
+					frontier = newFrontier;
+				}
+				size_t pos = frontierSize++;
+				while (pos > 0 && before(p, frontier[(pos - 1) >> 1])) {
+					frontier[pos] = frontier[(pos - 1) >> 1];
+					pos = (pos - 1) >> 1;
+				}
+				frontier[pos] = p;
+			}
+			void popFront() {
+				const node *p = frontier[--frontierSize];
+				size_t pos = 0;
+				while (true) {
+					size_t child = (pos << 1) + 1;
+					if (child >= frontierSize) break;
+					if (child + 1 < frontierSize && before(frontier[child + 1], frontier[child])) ++child;
+					if (!before(frontier[child], p)) break;
+					frontier[pos] = frontier[child];
+					pos = child;
+				}
+				if (frontierSize > 0) frontier[pos] = p;
+			}
+			ordered_iterator(const priority_queue *_own) : own(_own), frontier(NULL), frontierSize(0), capacity(0) {}
+		public:
+			ordered_iterator() : own(NULL), frontier(NULL), frontierSize(0), capacity(0) {}
+			ordered_iterator(const ordered_iterator &other) : own(other.own), frontier(NULL), frontierSize(other.frontierSize), capacity(other.frontierSize) {
+				if (capacity > 0) frontier = new const node*[capacity];
+				for (size_t i = 0; i < frontierSize; ++i) {
+					frontier[i] = other.frontier[i];
+				}
+			}
+			ordered_iterator &operator=(const ordered_iterator &other) {
+				if (this == &other) return *this;
+				delete[] frontier;
+				own = other.own;
+				frontier = NULL;
+				frontierSize = capacity = other.frontierSize;
+				if (capacity > 0) frontier = new const node*[capacity];
+				for (size_t i = 0; i < frontierSize; ++i) {
+					frontier[i] = other.frontier[i];
+				}
+				return *this;
+			}
+			~ordered_iterator() {
+				delete[] frontier;
+			}
+			const T & operator*() const {
+				if (frontierSize == 0) throw invalid_iterator();
+				return frontier[0]->value;
+			}
+			const T * operator->() const {
+				if (frontierSize == 0) throw invalid_iterator();
+				return &(frontier[0]->value);
+			}
+			ordered_iterator & operator++() {
+				if (frontierSize == 0) throw invalid_iterator();
+				const node *p = frontier[0];
+				popFront();
+				push(p->leftChild);
+				push(p->rightChild);
+				return *this;
+			}
+			ordered_iterator operator++(int) {
+				ordered_iterator tmp = *this;
+				++*this;
+				return tmp;
+			}
+			bool operator==(const ordered_iterator &rhs) const {
+				if (own != rhs.own || frontierSize == 0 || rhs.frontierSize == 0) return own == rhs.own && frontierSize == rhs.frontierSize;
+				return frontier[0] == rhs.frontier[0];
+			}
+			bool operator!=(const ordered_iterator &rhs) const {
+				return !(*this == rhs);
+			}
+		};
+		priority_queue() : root(NULL), pendingHead(NULL), pendingTail(NULL), currentSize(0), chunks(NULL), freeList(NULL) {}
+		explicit priority_queue(const Compare &_comparator) : compare_holder<Compare>(_comparator), root(NULL), pendingHead(NULL), pendingTail(NULL), currentSize(0), chunks(NULL), freeList(NULL) {}
+		priority_queue(const priority_queue &other) : compare_holder<Compare>(other), root(NULL), pendingHead(NULL), pendingTail(NULL), currentSize(other.currentSize), chunks(NULL), freeList(NULL) {
+			other.consolidate();
+			try {
+				root = copyTree(other.root);
+			} catch (...) {
+				releaseChunks();
+				throw;
 			}
-			else root = NULL;
 		}
 		~priority_queue() {
-			currentSize = 0;
-			if (root != NULL) {
-				root->clear();
-				delete root;
-			}
+			clear();
 		}
 		priority_queue &operator=(const priority_queue &other) {
 			if (this == &other) return *this;
-			currentSize = other.currentSize;
-			if (root != NULL) {
-				root->clear();
-				delete root;
+			clear();
+			compare_holder<Compare>::operator=(other);
+			other.consolidate();
+			try {
+				root = copyTree(other.root);
+			} catch (...) {
+				clear();
+				throw;
 			}
-			if (other.root != NULL) {
-				root = new node(other.root);
-			}
-			else root = NULL;
+			currentSize = other.currentSize;
 			return *this;
 		}
-		node* mergeNode(node *a, node *b) {
+		/**
+		 * O(chunks) when T is trivially destructible.
+		 */
+		void clear() {
+			currentSize = 0;
+			clearPending();
+			releaseChunks();
+			root = NULL;
+		}
+		node* mergeNode(node *a, node *b) const {
 			if (a == NULL) return b;
 			if (b == NULL) return a;
-			static Compare comparator;
-			if (comparator(a->value, b->value)) swap(a, b);
+			if (this->comparator()(a->value, b->value)) swap(a, b);
 			a->rightChild = mergeNode(a->rightChild, b);
 			a->maintain();
 			return a;
 		}
 		const T & top() const {
 			if (currentSize == 0) throw container_is_empty();
+			consolidate();
 			return root->value;
 		}
 		void push(const T &e) {
-			++currentSize;
-			node *p = new node(e);
+			node *p = allocate(e);
 			root = mergeNode(root, p);
+			++currentSize;
 		}
 		void pop() {
 			if (currentSize == 0) throw container_is_empty();
+			consolidate();
 			currentSize--;
 			node *tmp = root;
 			root = mergeNode(root->leftChild, root->rightChild);
-			delete tmp;
+			deallocate(tmp);
+		}
+		/**
+		 * Heaps still pending from lazy_merge join the frontier directly, so
+		 * nothing is consolidated.
+		 */
+		ordered_iterator ordered_begin() const {
+			ordered_iterator result(this);
+			result.push(root);
+			for (pendingTree *p = pendingHead; p != NULL; p = p->next) {
+				result.push(p->root);
+			}
+			return result;
+		}
+		ordered_iterator ordered_end() const {
+			return ordered_iterator(this);
+		}
+		/**
+		 * Copy the k best elements to out, best first, leaving the queue as it is.
+		 */
+		template<class OutputIterator>
+		OutputIterator peek_k(size_t k, OutputIterator out) const {
+			for (ordered_iterator it = ordered_begin(); k > 0 && it != ordered_end(); --k, ++it, ++out) {
+				*out = *it;
+			}
+			return out;
 		}
 		size_t size() const {
 			return currentSize;
@@ -115,11 +374,94 @@ namespace sjtu {
 			return currentSize == 0;
 		}
 		void merge(priority_queue &other) {
+			if (this == &other) return;
+			other.consolidate();
 			root = mergeNode(root, other.root);
+			adoptChunks(other);
 			currentSize += other.currentSize;
 			other.root = NULL;
 			other.currentSize = 0;
 		}
+		/**
+		 * Move every element to out in priority order and leave the queue empty.
+		 * Nodes are only unlinked as they are consumed and released together at
+		 * the end, with no size checks or recursion per element.
+		 */
+		template<class OutputIterator>
+		OutputIterator drain_sorted(OutputIterator out) {
+			consolidate();
+			while (root != NULL) {
+				*out = std::move(root->value);
+				++out;
+				root = mergeNode(root->leftChild, root->rightChild);
+			}
+			clear();
+			return out;
+		}
+		/**
+		 * O(1) merge: other's heaps are only queued here and get merged on the
+		 * next top() or pop(), so melding many queues and popping a few is cheap.
+		 */
+		void lazy_merge(priority_queue &other) {
+			if (this == &other) return;
+			if (other.root != NULL) {
+				pendingTree *p = new pendingTree(other.root);
+				if (pendingHead == NULL) pendingHead = p;
+				else pendingTail->next = p;
+				pendingTail = p;
+			}
+			if (other.pendingHead != NULL) {
+				if (pendingHead == NULL) pendingHead = other.pendingHead;
+				else pendingTail->next = other.pendingHead;
+				pendingTail = other.pendingTail;
+			}
+			adoptChunks(other);
+			currentSize += other.currentSize;
+			other.root = NULL;
+			other.pendingHead = other.pendingTail = NULL;
+			other.currentSize = 0;
+		}
 	};
+
+	/**
+	 * Sort [first, last) into ascending order under comp with a leftist heap.
+	 * All nodes come from one allocation and the heap is built by merging
+	 * pairs in rounds, which is O(n); each extraction is one mergeNode.
+	 */
+	template<class RandomIt, class Compare>
+	void heap_sort(RandomIt first, RandomIt last, Compare comp) {
+		typedef typename std::iterator_traits<RandomIt>::value_type T;
+		typedef typename priority_queue<T, Compare>::node node;
+		size_t n = last - first;
+		if (n < 2) return;
+		priority_queue<T, Compare> heap(comp);
+		node *nodes = static_cast<node*>(::operator new(sizeof(node) * n));
+		node **roots = new node*[n];
+		for (size_t i = 0; i < n; ++i) {
+			roots[i] = new (nodes + i) node(std::move(first[i]));
+		}
+		for (size_t count = n; count > 1;) {
+			size_t k = 0;
+			for (size_t i = 0; i + 1 < count; i += 2) {
+				roots[k++] = heap.mergeNode(roots[i], roots[i + 1]);
+			}
+			if (count & 1) roots[k++] = roots[count - 1];
+			count = k;
+		}
+		node *root = roots[0];
+		delete[] roots;
+		for (size_t i = n; i > 0; --i) {
+			first[i - 1] = std::move(root->value);
+			root = heap.mergeNode(root->leftChild, root->rightChild);
+		}
+		for (size_t i = 0; i < n; ++i) {
+			nodes[i].~node();
+		}
+		::operator delete(nodes);
+	}
+	template<class RandomIt>
+	void heap_sort(RandomIt first, RandomIt last) {
+		heap_sort(first, last, std::less<typename std::iterator_traits<RandomIt>::value_type>());
+	}
 }
 #endif
@@ -0,0 +1,182 @@
+#ifndef SJTU_RADIX_HEAP_HPP
+#define SJTU_RADIX_HEAP_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include "exceptions.hpp"
+#include "priority_queue.hpp"
+
+namespace sjtu {
+
+	/**
+	 * Monotone min-queue for integral keys (radix heap).
+	 * A key may not be pushed below the last key popped, which holds for timer
+	 * deadlines and Dijkstra distances; keys below the current top() are fine.
+	 * Keys sit in one bucket per bit position of their difference from the last
+	 * popped key, so push is O(1) and each key is moved between buckets at most
+	 * once per bit: O(log C) amortized pops with no comparisons between keys.
+	 * Pops the smallest key first, like priority_queue<T, std::greater<T>>.
+	 */
+	template<typename T>
+	class radix_heap {
+		static_assert(std::is_integral<T>::value, "radix_heap needs an integral key");
+		static_assert(!std::is_same<typename std::remove_cv<T>::type, bool>::value, "radix_heap needs an integral key other than bool");
+	private:
+		typedef typename std::make_unsigned<T>::type U;
+		static const size_t bucketCount = std::numeric_limits<U>::digits + 1;
+		struct bucket {
+			U *data;
+			size_t size, capacity;
+			bucket() : data(NULL), size(0), capacity(0) {}
+			~bucket() {
+				delete[] data;
+			}
+			void push(U key) {
+				if (size == capacity) {
+					capacity = capacity == 0 ? 8 : capacity << 1;
+					U *newData = new U[capacity];
+					if (size > 0) memcpy(newData, data, sizeof(U) * size);
+					delete[] data;
+					data = newData;
+				}
+				data[size++] = key;
+			}
+		};
+		bucket buckets[bucketCount];
+		U last;
+		size_t currentSize;
+		/**
+		 * top() without a pop in between scans the first non-empty bucket only
+		 * once; push keeps the cached minimum up to date.
+		 */
+		mutable U minimum;
+		mutable bool hasMinimum;
+
+		/**
+		 * Order-preserving map of T onto U: flips the sign bit of signed keys.
+		 */
+		static U encode(const T &key) {
+			U result = static_cast<U>(key);
+			if (std::is_signed<T>::value) result ^= static_cast<U>(U(1) << (std::numeric_limits<U>::digits - 1));
+			return result;
+		}
+		static T decode(U key) {
+			if (std::is_signed<T>::value) key ^= static_cast<U>(U(1) << (std::numeric_limits<U>::digits - 1));
+			return static_cast<T>(key);
+		}
+		static size_t bitWidth(U x) {
+#if defined(__GNUC__)
+			return x == 0 ? 0 : std::numeric_limits<unsigned long long>::digits - __builtin_clzll(static_cast<unsigned long long>(x));
+#else
+			size_t width = 0;
+			for (; x != 0; x >>= 1) ++width;
+			return width;
+#endif
+		}
+		size_t bucketOf(U key) const {
+			return bitWidth(static_cast<U>(key ^ last));
+		}
+		/**
+		 * Refill bucket 0 from the first non-empty bucket, whose minimum becomes last.
+		 */
+		void pull() {
+			if (buckets[0].size > 0) return;
+			size_t i = 1;
+			while (buckets[i].size == 0) ++i;
+			bucket &b = buckets[i];
+			U smallest = b.data[0];
+			if (hasMinimum) smallest = minimum;
+			else {
+				for (size_t j = 1; j < b.size; ++j) {
+					if (b.data[j] < smallest) smallest = b.data[j];
+				}
+			}
+			last = smallest;
+			for (size_t j = 0; j < b.size; ++j) {
+				buckets[bucketOf(b.data[j])].push(b.data[j]);
+			}
+			b.size = 0;
+		}
+	public:
+		radix_heap() : last(0), currentSize(0), minimum(0), hasMinimum(false) {}
+		radix_heap(const radix_heap &other) : last(other.last), currentSize(other.currentSize), minimum(other.minimum), hasMinimum(other.hasMinimum) {
+			for (size_t i = 0; i < bucketCount; ++i) {
+				for (size_t j = 0; j < other.buckets[i].size; ++j) {
+					buckets[i].push(other.buckets[i].data[j]);
+				}
+			}
+		}
+		radix_heap &operator=(const radix_heap &other) {
+			if (this == &other) return *this;
+			last = other.last;
+			currentSize = other.currentSize;
+			minimum = other.minimum;
+			hasMinimum = other.hasMinimum;
+			for (size_t i = 0; i < bucketCount; ++i) {
+				buckets[i].size = 0;
+				for (size_t j = 0; j < other.buckets[i].size; ++j) {
+					buckets[i].push(other.buckets[i].data[j]);
+				}
+			}
+			return *this;
+		}
+		/**
+		 * Throws runtime_error when e is smaller than the last key popped.
+		 */
+		void push(const T &e) {
+			U key = encode(e);
+			if (key < last) throw runtime_error();
+			buckets[bucketOf(key)].push(key);
+			if (hasMinimum && key < minimum) minimum = key;
+			++currentSize;
+		}
+		const T top() const {
+			if (currentSize == 0) throw container_is_empty();
+			if (buckets[0].size > 0) return decode(last);
+			if (!hasMinimum) {
+				size_t i = 1;
+				while (buckets[i].size == 0) ++i;
+				const bucket &b = buckets[i];
+				minimum = b.data[0];
+				for (size_t j = 1; j < b.size; ++j) {
+					if (b.data[j] < minimum) minimum = b.data[j];
+				}
+				hasMinimum = true;
+			}
+			return decode(minimum);
+		}
+		void pop() {
+			if (currentSize == 0) throw container_is_empty();
+			pull();
+			hasMinimum = false;
+			--buckets[0].size;
+			--currentSize;
+		}
+		size_t size() const {
+			return currentSize;
+		}
+		bool empty() const {
+			return currentSize == 0;
+		}
+	};
+
+	struct monotone_tag {};
+
+	/**
+	 * Picks the queue implementation: priority_queue by default, radix_heap for
+	 * integral keys other than bool popped smallest first when the caller
+	 * promises monotone pushes with monotone_tag.
+	 */
+	template<typename T, class Compare = std::less<T>, class Tag = void>
+	struct select_priority_queue {
+		typedef priority_queue<T, Compare> type;
+	};
+	template<typename T>
+	struct select_priority_queue<T, std::greater<T>, monotone_tag> {
+		typedef typename std::conditional<std::is_integral<T>::value && !std::is_same<T, bool>::value, radix_heap<T>, priority_queue<T, std::greater<T>>>::type type;
+	};
+}
+#endif
@@ -0,0 +1,133 @@
+#ifndef SJTU_TOP_K_HPP
+#define SJTU_TOP_K_HPP
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <utility>
+#include "exceptions.hpp"
+#include "utility.hpp"
+
+namespace sjtu {
+
+	/**
+	 * Keeps the k best elements of a stream, "best" meaning what
+	 * priority_queue<T, Compare> would return first.
+	 * The kept elements form an array heap with the worst one at the root, so a
+	 * candidate that is not better than it is rejected with one comparison.
+	 */
+	template<typename T, class Compare = std::less<T>>
+	class top_k : private compare_holder<Compare> {
+	private:
+		T *data;
+		size_t k, currentSize;
+		using compare_holder<Compare>::comparator;
+
+		void siftUp(size_t pos) {
+			T value = std::move(data[pos]);
+			while (pos > 0) {
+				size_t parent = (pos - 1) >> 1;
+				if (!comparator()(value, data[parent])) break;
+				data[pos] = std::move(data[parent]);
+				pos = parent;
+			}
+			data[pos] = std::move(value);
+		}
+		void siftDown(size_t pos, size_t size) {
+			T value = std::move(data[pos]);
+			while (true) {
+				size_t child = (pos << 1) + 1;
+				if (child >= size) break;
+				if (child + 1 < size && comparator()(data[child + 1], data[child])) ++child;
+				if (!comparator()(data[child], value)) break;
+				data[pos] = std::move(data[child]);
+				pos = child;
+			}
+			data[pos] = std::move(value);
+		}
+	public:
+		explicit top_k(size_t _k, const Compare &_comparator = Compare()) : compare_holder<Compare>(_comparator), k(_k), currentSize(0) {
+			data = static_cast<T*>(::operator new(sizeof(T) * (k == 0 ? 1 : k)));
+		}
+		top_k(const top_k &other) : compare_holder<Compare>(other), k(other.k), currentSize(other.currentSize) {
+			data = static_cast<T*>(::operator new(sizeof(T) * (k == 0 ? 1 : k)));
+			for (size_t i = 0; i < currentSize; ++i) {
+				new (data + i) T(other.data[i]);
+			}
+		}
+		top_k &operator=(const top_k &other) {
+			if (this == &other) return *this;
+			clear();
+			::operator delete(data);
+			k = other.k;
+			compare_holder<Compare>::operator=(other);
+			data = static_cast<T*>(::operator new(sizeof(T) * (k == 0 ? 1 : k)));
+			for (; currentSize < other.currentSize; ++currentSize) {
+				new (data + currentSize) T(other.data[currentSize]);
+			}
+			return *this;
+		}
+		~top_k() {
+			clear();
+			::operator delete(data);
+		}
+		/**
+		 * Returns whether e was kept.
+		 */
+		bool push(const T &e) {
+			if (currentSize < k) {
+				new (data + currentSize) T(e);
+				siftUp(currentSize++);
+				return true;
+			}
+			if (k == 0 || !comparator()(data[0], e)) return false;
+			data[0] = e;
+			siftDown(0, currentSize);
+			return true;
+		}
+		/**
+		 * The element the next better candidate would evict.
+		 */
+		const T & worst() const {
+			if (currentSize == 0) throw container_is_empty();
+			return data[0];
+		}
+		size_t size() const {
+			return currentSize;
+		}
+		size_t capacity() const {
+			return k;
+		}
+		bool empty() const {
+			return currentSize == 0;
+		}
+		bool full() const {
+			return currentSize == k;
+		}
+		void clear() {
+			for (size_t i = 0; i < currentSize; ++i) {
+				data[i].~T();
+			}
+			currentSize = 0;
+		}
+		/**
+		 * Move the kept elements to out, best first, and leave the container empty.
+		 * Sorts in place by heap sort, so no extra memory is used.
+		 */
+		template<class OutputIterator>
+		OutputIterator sorted_drain(OutputIterator out) {
+			for (size_t i = currentSize; i > 1; --i) {
+				T tmp = std::move(data[0]);
+				data[0] = std::move(data[i - 1]);
+				data[i - 1] = std::move(tmp);
+				siftDown(0, i - 1);
+			}
+			for (size_t i = 0; i < currentSize; ++i, ++out) {
+				*out = std::move(data[i]);
+			}
+			clear();
+			return out;
+		}
+	};
+}
+#endif
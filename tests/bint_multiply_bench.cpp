@@ -0,0 +1,101 @@
+/*
+ * Util::Bint multiplication time over operand sizes, for locating the
+ * cutovers in class-bint.hpp. Sizes are in 32-bit limbs per operand; each
+ * row gives the kernel the cutovers pick, the best of several runs, and that
+ * time over n^1.585 (the Karatsuba exponent), which flattens where the
+ * chosen kernel is the right one and jumps at a misplaced cutover.
+ *
+ *   g++ -std=c++11 -O2 tests/bint_multiply_bench.cpp -o bint_multiply_bench
+ *   ./bint_multiply_bench [min_limbs] [max_limbs] [steps_per_doubling]
+ *
+ * To find a crossover, build a second binary with one cutover moved out of
+ * the way, e.g. -DBINT_KARATSUBA_THRESHOLD=1000000000 to keep the schoolbook
+ * kernel, run both over the same sizes and take the size where the times
+ * cross. The macros are BINT_SCHOOLBOOK_THRESHOLD (limbs) and
+ * BINT_KARATSUBA_THRESHOLD, BINT_TOOM3_THRESHOLD, BINT_NTT_THRESHOLD (16-bit
+ * halves, two per limb). Differences under about 10% are noise.
+ */
+#include "../priority_queue/class-bint.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+using Util::Bint;
+
+namespace {
+
+std::mt19937_64 rng(20261019);
+
+/*
+ * A random operand of about n limbs: 32 * log10(2) digits per limb.
+ */
+Bint makeOperand(size_t n)
+{
+	std::string s(std::max<size_t>(1, static_cast<size_t>(n * 9.633)), '0');
+	for (size_t i = 0; i < s.size(); ++i) {
+		s[i] = static_cast<char>('0' + rng() % 10);
+	}
+	s[0] = static_cast<char>('1' + rng() % 9);
+	return Bint(s);
+}
+
+const char *kernel(size_t limbs)
+{
+	size_t halves = limbs << 1;
+	if (limbs < Util::SCHOOLBOOK_THRESHOLD) {
+		return "limb schoolbook";
+	}
+	if (halves < Util::KARATSUBA_THRESHOLD) {
+		return "schoolbook";
+	}
+	if (halves >= Util::NTT_THRESHOLD && 2 * halves <= Util::NTT_MAX_LENGTH) {
+		return "ntt";
+	}
+	return halves >= Util::TOOM3_THRESHOLD ? "toom3" : "karatsuba";
+}
+
+/*
+ * Best of enough runs to fill about 50 ms, at least three.
+ */
+double bestSeconds(const Bint &a, const Bint &b)
+{
+	double best = 1e30, total = 0;
+	for (int run = 0; run < 3 || (total < 0.05 && run < 1000); ++run) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		Bint c = a * b;
+		double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		best = std::min(best, t);
+		total += t;
+	}
+	return best;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	size_t minLimbs = argc > 1 ? strtoull(argv[1], NULL, 10) : 64;
+	size_t maxLimbs = argc > 2 ? strtoull(argv[2], NULL, 10) : 65536;
+	size_t steps = argc > 3 ? strtoull(argv[3], NULL, 10) : 4;
+	printf("cutovers: schoolbook %zu limbs, karatsuba %zu, toom3 %zu, ntt %zu halves\n",
+	       Util::SCHOOLBOOK_THRESHOLD, Util::KARATSUBA_THRESHOLD, Util::TOOM3_THRESHOLD, Util::NTT_THRESHOLD);
+	printf("%8s  %-16s %12s %12s\n", "limbs", "kernel", "us", "ns/n^1.585");
+	size_t last = 0;
+	for (double x = static_cast<double>(std::max<size_t>(1, minLimbs)); x <= maxLimbs * 1.0001; x *= std::pow(2.0, 1.0 / std::max<size_t>(1, steps))) {
+		size_t n = static_cast<size_t>(x + 0.5);
+		if (n == last) {
+			continue;
+		}
+		last = n;
+		Bint a = makeOperand(n), b = makeOperand(n);
+		double t = bestSeconds(a, b);
+		printf("%8zu  %-16s %12.1f %12.3f\n", n, kernel(n), t * 1e6, t * 1e9 / std::pow(static_cast<double>(n), 1.585));
+		fflush(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * Randomized differential test of Util::Bint multiplication against a plain
+ * base-10000 schoolbook product computed here from the decimal strings.
+ * Operand lengths are drawn so that every cutover in class-bint.hpp (limb
+ * schoolbook, Karatsuba, Toom-3, NTT, lopsided splitting) is crossed.
+ *
+ *   g++ -std=c++11 -O2 tests/bint_multiply_test.cpp -o bint_multiply_test
+ *   ./bint_multiply_test [seed] [cases]
+ *
+ * Exits with 1 and prints the failing operand lengths on a mismatch.
+ */
+#include "../priority_queue/class-bint.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Util::Bint;
+
+namespace {
+
+std::mt19937_64 rng;
+
+/*
+ * Digits without sign or leading zeros: random, all nines, a power of ten,
+ * or random with long runs of zeros.
+ */
+std::string makeDigits(size_t n)
+{
+	std::string s(n, '0');
+	switch (rng() % 4) {
+	case 0:
+		for (size_t i = 0; i < n; ++i) {
+			s[i] = static_cast<char>('0' + rng() % 10);
+		}
+		break;
+	case 1:
+		s.assign(n, '9');
+		break;
+	case 2:
+		break;
+	default:
+		for (size_t i = 0; i < n; ++i) {
+			s[i] = rng() % 16 == 0 ? static_cast<char>('0' + rng() % 10) : '0';
+		}
+		break;
+	}
+	s[0] = static_cast<char>('1' + rng() % 9);
+	return s;
+}
+
+/*
+ * Digit count, log-uniform in [1, limit].
+ */
+size_t drawLength(size_t limit)
+{
+	double exponent = std::uniform_real_distribution<double>(0, std::log(static_cast<double>(limit)))(rng);
+	return std::max<size_t>(1, static_cast<size_t>(std::exp(exponent)));
+}
+
+std::vector<long long> toBase10000(const std::string &s)
+{
+	std::vector<long long> x;
+	for (size_t end = s.size(); end > 0; end = end >= 4 ? end - 4 : 0) {
+		size_t begin = end >= 4 ? end - 4 : 0;
+		x.push_back(atoll(s.substr(begin, end - begin).c_str()));
+	}
+	return x;
+}
+
+std::string schoolbook(const std::string &a, const std::string &b)
+{
+	std::vector<long long> x = toBase10000(a), y = toBase10000(b);
+	std::vector<long long> z(x.size() + y.size(), 0);
+	for (size_t i = 0; i < x.size(); ++i) {
+		for (size_t j = 0; j < y.size(); ++j) {
+			z[i + j] += x[i] * y[j];
+		}
+		if (i % 1024 == 1023 || i + 1 == x.size()) {
+			long long carry = 0;
+			for (size_t k = 0; k < z.size(); ++k) {
+				z[k] += carry;
+				carry = z[k] / 10000;
+				z[k] %= 10000;
+			}
+		}
+	}
+	while (z.size() > 1 && z.back() == 0) {
+		z.pop_back();
+	}
+	std::string s = std::to_string(z.back());
+	char digits[5];
+	for (size_t k = z.size() - 1; k-- > 0;) {
+		snprintf(digits, sizeof(digits), "%04lld", z[k]);
+		s += digits;
+	}
+	return s;
+}
+
+std::string print(const Bint &x)
+{
+	std::ostringstream os;
+	os << x;
+	return os.str();
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long seed = argc > 1 ? strtoull(argv[1], NULL, 10) : 20261019;
+	size_t cases = argc > 2 ? strtoull(argv[2], NULL, 10) : 300;
+	rng.seed(seed);
+	size_t failures = 0;
+	for (size_t t = 0; t < cases; ++t) {
+		// Most cases stay below the NTT cutover (about 59000 digits in the
+		// shorter operand) so the schoolbook reference is cheap; one in
+		// twenty has both operands between 50000 and 100000 digits.
+		size_t na, nb;
+		if (t % 20 == 19) {
+			na = 50000 + rng() % 50000;
+			nb = 50000 + rng() % 50000;
+		} else {
+			na = drawLength(40000);
+			nb = t % 3 == 0 ? na : drawLength(40000);
+		}
+		std::string da = makeDigits(na), db = makeDigits(nb);
+		bool minusA = rng() % 2, minusB = rng() % 2;
+		Bint a((minusA ? "-" : "") + da), b((minusB ? "-" : "") + db);
+		std::string expected = schoolbook(da, db);
+		if (expected != "0" && minusA != minusB) {
+			expected = "-" + expected;
+		}
+		std::string square = schoolbook(da, da);
+		Bint inPlace(a);
+		inPlace *= b;
+		if (print(a * b) != expected || print(Bint(a) * b) != expected || print(inPlace) != expected || print(a * a) != square) {
+			printf("mismatch: seed %llu case %zu, %zu x %zu digits\n", seed, t, na, nb);
+			++failures;
+		}
+	}
+	printf("%zu cases, %zu failures\n", cases, failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+/*
+ * Throughput of sjtu::concurrent_priority_queue over shard count and thread
+ * count. The queue is prefilled, then every thread alternates a push of a
+ * random key with a try_pop, so the size stays roughly constant.
+ *
+ *   g++ -std=c++11 -O2 -pthread tests/concurrent_priority_queue_bench.cpp -o concurrent_priority_queue_bench
+ *   ./concurrent_priority_queue_bench [max_threads] [operations]
+ *
+ * Threads run 1, 2, 4, ... up to max_threads (default 64); for each, shard
+ * counts 1, threads, 2 * threads and 4 * threads are tried. Counts above the
+ * number of cores measure oversubscription, not scaling.
+ */
+#include "../priority_queue/concurrent_priority_queue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t PREFILL = 100000;
+
+double run(size_t threads, size_t shards, size_t operations)
+{
+	sjtu::concurrent_priority_queue<unsigned> q(shards);
+	unsigned key = 12345;
+	for (size_t i = 0; i < PREFILL; ++i) {
+		key = key * 1103515245u + 12345u;
+		q.push(key);
+	}
+	size_t perThread = operations / threads;
+	std::atomic<bool> go(false);
+	std::vector<std::thread> pool;
+	for (size_t t = 0; t < threads; ++t) {
+		pool.push_back(std::thread([&q, &go, perThread, t]() {
+			unsigned x = static_cast<unsigned>(t) * 2654435761u + 1, value;
+			while (!go.load(std::memory_order_acquire)) {
+				std::this_thread::yield();
+			}
+			for (size_t i = 0; i < perThread; i += 2) {
+				x = x * 1103515245u + 12345u;
+				q.push(x);
+				q.try_pop(value);
+			}
+		}));
+	}
+	Clock::time_point start = Clock::now();
+	go.store(true, std::memory_order_release);
+	for (size_t t = 0; t < threads; ++t) {
+		pool[t].join();
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	return perThread * threads / seconds / 1e6;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	size_t maxThreads = argc > 1 ? strtoull(argv[1], NULL, 10) : 64;
+	size_t operations = argc > 2 ? strtoull(argv[2], NULL, 10) : 4000000;
+	printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+	printf("threads   Mops/s at shards: 1 / threads / 2x / 4x\n");
+	for (size_t threads = 1; threads <= maxThreads; threads <<= 1) {
+		printf("%7zu", threads);
+		size_t shards[] = {1, threads, 2 * threads, 4 * threads};
+		for (size_t i = 0; i < 4; ++i) {
+			printf("  %3zu: %7.2f", shards[i], run(threads, shards[i], operations));
+			fflush(stdout);
+		}
+		printf("\n");
+	}
+	return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Throughput and latency of sjtu::spsc_queue and sjtu::mpmc_queue.
+ *
+ *   g++ -std=c++11 -O2 -pthread tests/concurrent_queue_bench.cpp -o concurrent_queue_bench
+ *   ./concurrent_queue_bench [max_threads] [items]
+ *
+ * One thread: push then pop on each queue, the uncontended cost. spsc: one
+ * producer and one consumer; throughput, and the round trip of a ping-pong
+ * through two queues. mpmc: thread counts 2, 4, ... up to
+ * max_threads (default 64), half producers and half consumers, with the
+ * push-to-pop latency of every 64th item. Counts above the number of cores
+ * measure oversubscription, not scaling.
+ */
+#include "../deque/concurrent_queue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+long long now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+double seconds(Clock::time_point since)
+{
+	return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+double percentile(std::vector<long long> &x, double p)
+{
+	if (x.empty()) {
+		return 0;
+	}
+	size_t k = std::min(x.size() - 1, static_cast<size_t>(p * x.size()));
+	std::nth_element(x.begin(), x.begin() + k, x.end());
+	return static_cast<double>(x[k]);
+}
+
+void single(size_t items)
+{
+	sjtu::spsc_queue<size_t> s(1024);
+	sjtu::mpmc_queue<size_t> m(1024);
+	size_t value = 0, sum = 0;
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < items; ++i) {
+		s.try_push(i);
+		s.try_pop(value);
+		sum += value;
+	}
+	double ts = seconds(start);
+	start = Clock::now();
+	for (size_t i = 0; i < items; ++i) {
+		m.try_push(i);
+		m.try_pop(value);
+		sum += value;
+	}
+	double tm = seconds(start);
+	printf("1 thread  spsc %8.2f Mops/s  mpmc %8.2f Mops/s (checksum %s)\n", items / ts / 1e6, items / tm / 1e6, sum == items * (items - 1) ? "ok" : "BAD");
+}
+
+void spsc(size_t items)
+{
+	sjtu::spsc_queue<size_t> q(1024);
+	Clock::time_point start = Clock::now();
+	std::thread producer([&q, items]() {
+		for (size_t i = 0; i < items; ++i) {
+			while (!q.try_push(i)) {
+				std::this_thread::yield();
+			}
+		}
+	});
+	size_t value, sum = 0;
+	for (size_t i = 0; i < items; ++i) {
+		while (!q.try_pop(value)) {
+			std::this_thread::yield();
+		}
+		sum += value;
+	}
+	producer.join();
+	double t = seconds(start);
+	printf("spsc  throughput %8.2f Mops/s (checksum %s)\n", items / t / 1e6, sum == items * (items - 1) / 2 ? "ok" : "BAD");
+
+	sjtu::spsc_queue<size_t> ping(2), pong(2);
+	size_t rounds = std::max<size_t>(1000, items / 100);
+	start = Clock::now();
+	std::thread echo([&ping, &pong, rounds]() {
+		size_t x;
+		for (size_t i = 0; i < rounds; ++i) {
+			while (!ping.try_pop(x)) {
+				std::this_thread::yield();
+			}
+			while (!pong.try_push(x)) {
+				std::this_thread::yield();
+			}
+		}
+	});
+	for (size_t i = 0; i < rounds; ++i) {
+		size_t x;
+		while (!ping.try_push(i)) {
+			std::this_thread::yield();
+		}
+		while (!pong.try_pop(x)) {
+			std::this_thread::yield();
+		}
+	}
+	echo.join();
+	printf("spsc  round trip %8.0f ns\n", seconds(start) / rounds * 1e9);
+}
+
+void mpmc(size_t threads, size_t items)
+{
+	size_t producers = std::max<size_t>(1, threads / 2), consumers = std::max<size_t>(1, threads - producers);
+	size_t perProducer = items / producers;
+	sjtu::mpmc_queue<long long> q(4096);
+	std::atomic<size_t> remaining(perProducer * producers);
+	std::vector<std::vector<long long> > latency(consumers);
+	std::vector<std::thread> pool;
+	Clock::time_point start = Clock::now();
+	for (size_t p = 0; p < producers; ++p) {
+		pool.push_back(std::thread([&q, perProducer]() {
+			for (size_t i = 0; i < perProducer; ++i) {
+				while (!q.try_push(i % 64 == 0 ? now() : 0)) {
+					std::this_thread::yield();
+				}
+			}
+		}));
+	}
+	for (size_t c = 0; c < consumers; ++c) {
+		pool.push_back(std::thread([&q, &remaining, &latency, c]() {
+			long long stamp;
+			while (remaining.load(std::memory_order_relaxed) > 0) {
+				if (!q.try_pop(stamp)) {
+					std::this_thread::yield();
+					continue;
+				}
+				remaining.fetch_sub(1, std::memory_order_relaxed);
+				if (stamp != 0) {
+					latency[c].push_back(now() - stamp);
+				}
+			}
+		}));
+	}
+	for (size_t i = 0; i < pool.size(); ++i) {
+		pool[i].join();
+	}
+	double t = seconds(start);
+	std::vector<long long> all;
+	for (size_t c = 0; c < consumers; ++c) {
+		all.insert(all.end(), latency[c].begin(), latency[c].end());
+	}
+	double p50 = percentile(all, 0.5), p99 = percentile(all, 0.99);
+	printf("mpmc %2zu producers %2zu consumers %8.2f Mops/s  latency p50 %9.0f ns  p99 %9.0f ns\n", producers, consumers, perProducer * producers / t / 1e6, p50, p99);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	size_t maxThreads = argc > 1 ? strtoull(argv[1], NULL, 10) : 64;
+	size_t items = argc > 2 ? strtoull(argv[2], NULL, 10) : 2000000;
+	printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+	single(items);
+	spsc(items);
+	for (size_t threads = 2; threads <= maxThreads; threads <<= 1) {
+		mpmc(threads, items);
+	}
+	return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * Scaling of the parallel Diamond::Matrix operations against the thread
+ * count set with Diamond::SetThreadCount: a double GEMM, a fused
+ * element-wise expression, and operator== on equal matrices (the case that
+ * cannot stop early).
+ *
+ *   g++ -std=c++11 -O2 -march=native -pthread tests/matrix_bench.cpp -o matrix_bench
+ *   ./matrix_bench [max_threads] [gemm_n] [elementwise_n]
+ *
+ * Thread counts run 1, 2, 4, ... up to max_threads (default 64). Each
+ * figure is the best of three runs; speedup is against one thread, and every
+ * result is compared with the one-thread result, which it must match
+ * exactly. Counts above the number of cores measure oversubscription, not
+ * scaling.
+ */
+#include "../priority_queue/class-matrix.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+using Diamond::Matrix;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+Matrix<double> randomMatrix(size_t rows, size_t cols, std::mt19937_64 &rng)
+{
+	std::uniform_real_distribution<double> value(-1, 1);
+	Matrix<double> a(rows, cols);
+	for (size_t i = 0; i < rows * cols; ++i) {
+		a.data()[i] = value(rng);
+	}
+	return a;
+}
+
+template<typename _Tf>
+double bestSeconds(const _Tf &f)
+{
+	double best = 1e30;
+	for (int run = 0; run < 3; ++run) {
+		Clock::time_point start = Clock::now();
+		f();
+		best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+	}
+	return best;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	size_t maxThreads = argc > 1 ? strtoull(argv[1], NULL, 10) : 64;
+	size_t gemmN = argc > 2 ? strtoull(argv[2], NULL, 10) : 1024;
+	size_t elementN = argc > 3 ? strtoull(argv[3], NULL, 10) : 4096;
+	std::mt19937_64 rng(20261019);
+	Matrix<double> a = randomMatrix(gemmN, gemmN, rng), b = randomMatrix(gemmN, gemmN, rng);
+	Matrix<double> x = randomMatrix(elementN, elementN, rng), y = randomMatrix(elementN, elementN, rng);
+	Matrix<double> product, sum, copy(x);
+	bool equal = false;
+	printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+	printf("gemm %zu x %zu, element-wise and == on %zu x %zu\n", gemmN, gemmN, elementN, elementN);
+
+	Matrix<double> product1, sum1;
+	double gemm1 = 0, element1 = 0, compare1 = 0;
+	for (size_t threads = 1; threads <= maxThreads; threads <<= 1) {
+		Diamond::SetThreadCount(threads);
+		double gemm = bestSeconds([&]() { product = a * b; });
+		double element = bestSeconds([&]() { sum = x * 2.0 + y - x / 4.0; });
+		double compare = bestSeconds([&]() { equal = x == copy; });
+		if (threads == 1) {
+			product1 = product;
+			sum1 = sum;
+			gemm1 = gemm;
+			element1 = element;
+			compare1 = compare;
+		}
+		bool same = equal && product == product1 && sum == sum1;
+		printf("%2zu threads  gemm %7.2f GFLOP/s x%5.2f  element-wise %7.2f ms x%5.2f  == %7.2f ms x%5.2f%s\n", threads,
+		       2e-9 * gemmN * gemmN * gemmN / gemm, gemm1 / gemm,
+		       element * 1e3, element1 / element,
+		       compare * 1e3, compare1 / compare, same ? "" : "  MISMATCH");
+		fflush(stdout);
+	}
+	Diamond::SetThreadCount(1);
+	return 0;
+}
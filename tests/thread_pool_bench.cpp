@@ -0,0 +1,109 @@
+/*
+ * Fork-join scaling of sjtu::thread_pool and sjtu::task_group: a recursive
+ * Fibonacci with a serial cutoff, and a quicksort that forks both halves of
+ * each partition above a grain size.
+ *
+ *   g++ -std=c++11 -O2 -pthread tests/thread_pool_bench.cpp -o thread_pool_bench
+ *   ./thread_pool_bench [max_threads] [fib_n] [sort_n]
+ *
+ * Pools of 1, 2, 4, ... up to max_threads (default 64) workers are timed
+ * against the serial code; speedup is serial time over pool time. Counts
+ * above the number of cores measure oversubscription, not scaling.
+ */
+#include "../deque/thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int FIB_CUTOFF = 20;
+const size_t SORT_GRAIN = 4096;
+
+double seconds(Clock::time_point since)
+{
+	return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+long long fibSerial(int n)
+{
+	return n < 2 ? n : fibSerial(n - 1) + fibSerial(n - 2);
+}
+
+long long fibParallel(sjtu::thread_pool &pool, int n)
+{
+	if (n < FIB_CUTOFF) {
+		return fibSerial(n);
+	}
+	long long x = 0, y;
+	sjtu::task_group group(pool);
+	group.run([&pool, &x, n]() { x = fibParallel(pool, n - 1); });
+	y = fibParallel(pool, n - 2);
+	group.wait();
+	return x + y;
+}
+
+void sortParallel(sjtu::thread_pool &pool, int *first, int *last)
+{
+	if (last - first <= static_cast<std::ptrdiff_t>(SORT_GRAIN)) {
+		std::sort(first, last);
+		return;
+	}
+	// Three-way split so runs of equal keys cannot unbalance the recursion.
+	int pivot = first[(last - first) / 2];
+	int *lower = std::partition(first, last, [pivot](int v) { return v < pivot; });
+	int *upper = std::partition(lower, last, [pivot](int v) { return !(pivot < v); });
+	sjtu::task_group group(pool);
+	group.run([&pool, first, lower]() { sortParallel(pool, first, lower); });
+	sortParallel(pool, upper, last);
+	group.wait();
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	size_t maxThreads = argc > 1 ? strtoull(argv[1], NULL, 10) : 64;
+	int fibN = argc > 2 ? atoi(argv[2]) : 40;
+	size_t sortN = argc > 3 ? strtoull(argv[3], NULL, 10) : 10000000;
+	printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+
+	Clock::time_point start = Clock::now();
+	long long expected = fibSerial(fibN);
+	double fibBase = seconds(start);
+
+	std::vector<int> input(sortN);
+	std::mt19937 rng(20261019);
+	for (size_t i = 0; i < sortN; ++i) {
+		input[i] = static_cast<int>(rng());
+	}
+	std::vector<int> sorted(input);
+	start = Clock::now();
+	std::sort(sorted.begin(), sorted.end());
+	double sortBase = seconds(start);
+
+	printf("serial    fib(%d) %8.3f s  sort(%zu) %8.3f s\n", fibN, fibBase, sortN, sortBase);
+	for (size_t threads = 1; threads <= maxThreads; threads <<= 1) {
+		sjtu::thread_pool pool(threads);
+		start = Clock::now();
+		long long fib = fibParallel(pool, fibN);
+		double fibTime = seconds(start);
+
+		std::vector<int> data(input);
+		start = Clock::now();
+		sortParallel(pool, data.data(), data.data() + data.size());
+		double sortTime = seconds(start);
+
+		printf("%2zu threads  fib %8.3f s x%5.2f%s  sort %8.3f s x%5.2f%s\n", threads,
+		       fibTime, fibBase / fibTime, fib == expected ? "" : " BAD",
+		       sortTime, sortBase / sortTime, data == sorted ? "" : " BAD");
+	}
+	return 0;
+}